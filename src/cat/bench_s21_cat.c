@@ -0,0 +1,30 @@
+#include <stddef.h>
+
+#include "s21_bench.h"
+
+static const BenchCase kCases[] = {
+    {"", NULL, CORPUS_HUGE},
+    {"-n", NULL, CORPUS_HUGE},
+    {"-b", NULL, CORPUS_HUGE},
+    {"-e", NULL, CORPUS_HUGE},
+    {"-t", NULL, CORPUS_HUGE},
+    {"-s", NULL, CORPUS_HUGE},
+    {"-b -e -n -s -t -v", NULL, CORPUS_HUGE},
+    {"", NULL, CORPUS_SMALL_FILES},
+    {"-n", NULL, CORPUS_SMALL_FILES},
+    {"", NULL, CORPUS_LONG_LINES},
+    {"-e", NULL, CORPUS_LONG_LINES},
+    {"", NULL, CORPUS_BINARY},
+    {"-v", NULL, CORPUS_BINARY},
+};
+
+/**
+ * Замер производительности s21_cat рядом с GNU cat
+ * @param argc Количество аргументов командной строки
+ * @param argv [размер_МБ] [--no-syscalls]
+ * @return Код завершения
+ */
+int main(int argc, char **argv) {
+  return run_bench_suite("./s21_cat", "cat", kCases,
+                         sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
@@ -8,13 +8,16 @@
  */
 int main(int argc, char **argv) {
   if (argc < 2) {
-    fprintf(stderr, "Использование: %s [-beEnstTv] [файл ...]\n", argv[0]);
+    fprintf(stderr, "Использование: %s [-beEnstTv] [--stats] [файл ...]\n",
+            argv[0]);
     return EXIT_FAILURE;
   }
 
   initialize_flags();
   parse_command_line_options(argc, argv);
+  if (flags.show_stats) enable_stats();
   process_input_files(argc, argv);
+  print_stats("s21_cat");
 
   return EXIT_SUCCESS;
 }
@@ -29,6 +32,7 @@ void initialize_flags(void) {
   flags.squeeze_blank = false;
   flags.show_tabs = false;
   flags.number_all = false;
+  flags.show_stats = false;
 }
 
 /**
@@ -39,10 +43,13 @@ void initialize_flags(void) {
 void parse_command_line_options(int argc, char **argv) {
   int option;
   const char *valid_options = "+beEnstTv";
+  static const struct option long_options[] = {
+      {"stats", no_argument, NULL, OPTION_STATS}, {NULL, 0, NULL, 0}};
 
   opterr = 0;  // Отключаем стандартные сообщения об ошибках
 
-  while ((option = getopt_long(argc, argv, valid_options, NULL, NULL)) != -1) {
+  while ((option = getopt_long(argc, argv, valid_options, long_options,
+                               NULL)) != -1) {
     switch (option) {
       case 'b':
         flags.number_nonempty = true;
@@ -73,6 +80,9 @@ void parse_command_line_options(int argc, char **argv) {
       case 'v':
         flags.show_nonprinting = true;
         break;
+      case OPTION_STATS:
+        flags.show_stats = true;
+        break;
       default:
         print_usage_error(argv[optind - 1]);
         exit(EXIT_FAILURE);
@@ -95,108 +105,243 @@ void print_usage_error(const char *invalid_option) {
  * @param argv Массив аргументов
  */
 void process_input_files(int argc, char **argv) {
-  size_t line_counter = 1;
-  int consecutive_empty_lines = -1;
+  static OutputWriter output;
+  CatState state = {1, -1, true, &output};
+  // Флаги не меняются после разбора, поэтому ядро выбирается один раз
+  TransformKernel kernel = select_transform_kernel();
+  init_writer(&output, STDOUT_FILENO);
+
   for (int i = optind; i < argc; i++) {
     FILE *input_file = fopen(argv[i], "r");
     if (input_file == NULL) {
+      writer_flush(&output);
       print_file_error(argv[i]);
       continue;
     }
 
-    process_file_contents(input_file, &line_counter, &consecutive_empty_lines);
+    uint64_t started = stats_start();
+    bool read = process_file_contents(input_file, kernel, &state);
+    stats_stop(TIMER_PROCESSING, started);
+    if (!read) {
+      writer_flush(&output);
+      print_read_error(argv[i]);
+    }
     fclose(input_file);
   }
+  writer_flush(&output);
 }
 
 void print_file_error(const char *filename) {
   fprintf(stderr, "s21_cat: Ошибка: Не удалось открыть файл %s\n", filename);
 }
 
+void print_read_error(const char *filename) {
+  fprintf(stderr, "s21_cat: Ошибка: Не удалось прочитать файл %s\n", filename);
+}
+
 /**
- * Обработка содержимого одного файла
- * @param file Указатель на файл для обработки
+ * Общее тело ядра преобразования. Параметры-флаги всегда передаются
+ * константами, поэтому после встраивания компилятор удаляет проверки
+ * выключенных флагов и неиспользуемые этапы целиком. Символы, не
+ * требующие обработки, копируются непрерывными участками
+ * @param input Входные данные
+ * @param length Длина входных данных
+ * @param state Состояние преобразования
+ * @param squeeze Флаг -s
+ * @param tabs Флаг -t/-T
+ * @param nonprinting Флаг -v
+ * @param ends Флаг -e/-E
+ * @param numbering Режим нумерации (-b/-n)
  */
-void process_file_contents(FILE *file, size_t *line_counter,
-                           int *consecutive_empty_lines) {
-  int current_char;
+static inline __attribute__((always_inline)) void transform_block(
+    const unsigned char *input, size_t length, CatState *state,
+    const bool squeeze, const bool tabs, const bool nonprinting,
+    const bool ends, const int numbering) {
+  OutputWriter *output = state->output;
+
+  if (!squeeze && !tabs && !nonprinting && !ends && numbering == NUMBER_NONE) {
+    writer_write(output, input, length);
+    return;
+  }
+
+  size_t run_start = 0;  // начало участка, который копируется без изменений
+  for (size_t i = 0; i < length; i++) {
+    int current_char = input[i];
+    bool special =
+        (current_char == '\n' && (squeeze || ends || numbering)) ||
+        (tabs && current_char == '\t') ||
+        (nonprinting && (current_char < 32 || current_char >= 127)) ||
+        (numbering && state->is_new_line);
 
-  bool is_new_line = true;
+    if (!special) {
+      if (squeeze) state->consecutive_empty_lines = 0;
+      continue;
+    }
+
+    writer_write(output, input + run_start, i - run_start);
+    run_start = i + 1;
 
-  while ((current_char = fgetc(file)) != EOF) {
     // Обработка флага -s (сжатие пустых строк)
-    if (flags.squeeze_blank && should_skip_repeated_empty_lines(
-                                   current_char, consecutive_empty_lines)) {
+    if (squeeze && should_skip_repeated_empty_lines(
+                       current_char, &state->consecutive_empty_lines)) {
       continue;
     }
 
     // Обработка флагов нумерации строк (-n и -b)
-    if (is_new_line) {
-      if (flags.number_nonempty && current_char != '\n') {
-        print_line_number(line_counter, &is_new_line);
-      } else if (flags.number_all) {
-        print_line_number(line_counter, &is_new_line);
+    if (numbering && state->is_new_line) {
+      if (numbering == NUMBER_ALL || current_char != '\n') {
+        print_line_number(output, &state->line_counter, &state->is_new_line);
       }
     }
 
     // Обработка флага -t (отображение табов)
-    if (flags.show_tabs && current_char == '\t') {
-      print_tab_character();
+    if (tabs && current_char == '\t') {
+      print_tab_character(output);
       continue;
     }
 
     // Обработка флага -v (отображение непечатаемых символов)
-    if (flags.show_nonprinting && current_char != '\n' &&
-        current_char != '\t') {
-      handle_nonprinting_characters(&current_char);
+    if (nonprinting && current_char != '\n' && current_char != '\t') {
+      handle_nonprinting_characters(output, &current_char);
     }
 
     // Обработка флага -e (отображение конца строк)
-    if (flags.show_ends && current_char == '\n') {
-      print_end_of_line();
+    if (ends && current_char == '\n') {
+      print_end_of_line(output);
     }
 
     // Вывод текущего символа
-    putchar(current_char);
+    writer_write_char(output, (char)current_char);
 
     // Обновление состояния новой строки
-    is_new_line = (current_char == '\n');
+    if (numbering) state->is_new_line = (current_char == '\n');
   }
+  writer_write(output, input + run_start, length - run_start);
 }
 
+/* X-макросы перечисляют все сочетания флагов: s, t, v, e и режим
+ * нумерации. Для каждого сочетания создается отдельное ядро */
+#define CAT_FOR_EACH_NUMBERING(X, s, t, v, e) \
+  X(s, t, v, e, 0) X(s, t, v, e, 1) X(s, t, v, e, 2)
+#define CAT_FOR_EACH_ENDS(X, s, t, v) \
+  CAT_FOR_EACH_NUMBERING(X, s, t, v, 0) CAT_FOR_EACH_NUMBERING(X, s, t, v, 1)
+#define CAT_FOR_EACH_NONPRINTING(X, s, t) \
+  CAT_FOR_EACH_ENDS(X, s, t, 0) CAT_FOR_EACH_ENDS(X, s, t, 1)
+#define CAT_FOR_EACH_TABS(X, s) \
+  CAT_FOR_EACH_NONPRINTING(X, s, 0) CAT_FOR_EACH_NONPRINTING(X, s, 1)
+#define CAT_FOR_EACH_KERNEL(X) CAT_FOR_EACH_TABS(X, 0) CAT_FOR_EACH_TABS(X, 1)
+
+#define CAT_KERNEL_INDEX(s, t, v, e, n) \
+  ((s) | (t) << 1 | (v) << 2 | (e) << 3 | (n) << 4)
+#define CAT_KERNEL_NAME(s, t, v, e, n) \
+  transform_s##s##_t##t##_v##v##_e##e##_n##n
+
+#define CAT_DEFINE_KERNEL(s, t, v, e, n)                            \
+  static void CAT_KERNEL_NAME(s, t, v, e, n)(                       \
+      const unsigned char *input, size_t length, CatState *state) { \
+    transform_block(input, length, state, s, t, v, e, n);           \
+  }
+#define CAT_KERNEL_ENTRY(s, t, v, e, n) \
+  [CAT_KERNEL_INDEX(s, t, v, e, n)] = CAT_KERNEL_NAME(s, t, v, e, n),
+
+CAT_FOR_EACH_KERNEL(CAT_DEFINE_KERNEL)
+
+static const TransformKernel kTransformKernels[] = {
+    CAT_FOR_EACH_KERNEL(CAT_KERNEL_ENTRY)};
+
 /**
- * Обработка непечатаемых символов (для флага -v)
+ * Выбор ядра преобразования по установленным флагам
+ * @return Указатель на специализированное ядро
+ */
+TransformKernel select_transform_kernel(void) {
+  int numbering = NUMBER_NONE;
+  if (flags.number_nonempty) {
+    numbering = NUMBER_NONEMPTY;
+  } else if (flags.number_all) {
+    numbering = NUMBER_ALL;
+  }
+  return kTransformKernels[CAT_KERNEL_INDEX(
+      flags.squeeze_blank, flags.show_tabs, flags.show_nonprinting,
+      flags.show_ends, numbering)];
+}
+
+/**
+ * Обработка содержимого одного файла. Обычный файл отображается в
+ * память, поэтому без флагов данные уходят в вывод без копирования
+ * @param file Указатель на файл для обработки
+ * @param kernel Ядро преобразования
+ * @param state Состояние преобразования
+ * @return false при ошибке чтения (в том числе если файл укоротили)
+ */
+bool process_file_contents(FILE *file, TransformKernel kernel,
+                           CatState *state) {
+  BlockReader reader;
+  const char *block;
+  size_t length;
+
+  state->is_new_line = true;
+  stats_add(STAT_FILES, 1);
+  bool initialized = init_block_reader(&reader, file, false);
+  if (initialized) {
+    while (read_block(&reader, &block, &length)) {
+      kernel((const unsigned char *)block, length, state);
+      if (stats_enabled) {
+        stats_add(STAT_LINES_SCANNED, count_newlines(block, length));
+      }
+    }
+  }
+  bool read = initialized && !reader.failed;
+  free_block_reader(&reader);
+  return read;
+}
+
+/**
+ * Обработка непечатаемых символов (для флага -v) в нотации ^X, ^? и M-X
+ * @param output Буфер вывода
  * @param character Указатель на обрабатываемый символ
  */
-void handle_nonprinting_characters(int *character) {
+void handle_nonprinting_characters(OutputWriter *output, int *character) {
+  if (*character >= 128) {  // старший бит выводится как M-
+    writer_write(output, "M-", 2);
+    *character -= 128;
+  }
   if (*character >= 0 && *character <= 31) {
-    putchar('^');
+    writer_write_char(output, '^');
     *character += 64;
   } else if (*character == 127) {
-    putchar('^');
+    writer_write_char(output, '^');
     *character = '?';
   }
 }
 
 /**
- * Печать номера строки (для флагов -n и -b)
+ * Печать номера строки (для флагов -n и -b) в формате "%6zu\t"
+ * @param output Буфер вывода
  * @param line_counter Счетчик строк
  * @param is_new_line Флаг новой строки
  */
-void print_line_number(size_t *line_counter, bool *is_new_line) {
-  printf("%6zu\t", (*line_counter)++);
+void print_line_number(OutputWriter *output, size_t *line_counter,
+                       bool *is_new_line) {
+  writer_write_number(output, (*line_counter)++, 6);
+  writer_write_char(output, '\t');
   *is_new_line = false;
 }
 
 /**
  * Печать табуляции в виде ^I (для флага -t)
+ * @param output Буфер вывода
  */
-void print_tab_character(void) { printf("^I"); }
+void print_tab_character(OutputWriter *output) {
+  writer_write(output, "^I", 2);
+}
 
 /**
  * Печать символа конца строки $ (для флага -e)
+ * @param output Буфер вывода
  */
-void print_end_of_line(void) { putchar('$'); }
+void print_end_of_line(OutputWriter *output) {
+  writer_write_char(output, '$');
+}
 
 /**
  * Проверка необходимости пропуска пустых строк (для флага -s)
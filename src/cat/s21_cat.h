@@ -6,6 +6,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#include "s21_reader.h"
+#include "s21_stats.h"
+#include "s21_writer.h"
 
 /* Структура для хранения флагов программы */
 typedef struct {
@@ -15,8 +20,27 @@ typedef struct {
   bool squeeze_blank;  // Флаг -s (сжимает несколько пустых строк)
   bool show_tabs;   // Флаг -t (показывает табы как ^I)
   bool number_all;  // Флаг -n (нумерует все строки)
+  bool show_stats;  // Флаг --stats (статистика в stderr)
 } ProgramFlags;
 
+/* Код длинной опции без короткого аналога */
+enum { OPTION_STATS = 256 };
+
+/* Режим нумерации строк */
+enum { NUMBER_NONE = 0, NUMBER_NONEMPTY = 1, NUMBER_ALL = 2 };
+
+/* Состояние преобразования, сохраняемое между блоками и файлами */
+typedef struct {
+  size_t line_counter;          // Номер следующей строки (-n, -b)
+  int consecutive_empty_lines;  // Счетчик пустых строк (-s)
+  bool is_new_line;             // Следующий символ начинает строку
+  OutputWriter* output;
+} CatState;
+
+/* Ядро преобразования, специализированное под сочетание флагов */
+typedef void (*TransformKernel)(const unsigned char *input, size_t length,
+                                CatState *state);
+
 ProgramFlags flags;
 
 void initialize_flags(void);
@@ -29,16 +53,21 @@ void process_input_files(int argc, char **argv);
 
 void print_file_error(const char *filename);
 
-void process_file_contents(FILE *file, size_t *line_counter,
-                           int *consecutive_empty_lines);
+void print_read_error(const char *filename);
+
+TransformKernel select_transform_kernel(void);
+
+bool process_file_contents(FILE *file, TransformKernel kernel,
+                           CatState *state);
 
-void handle_nonprinting_characters(int *character);
+void handle_nonprinting_characters(OutputWriter *output, int *character);
 
-void print_line_number(size_t *line_counter, bool *is_new_line);
+void print_line_number(OutputWriter *output, size_t *line_counter,
+                       bool *is_new_line);
 
-void print_tab_character(void);
+void print_tab_character(OutputWriter *output);
 
-void print_end_of_line(void);
+void print_end_of_line(OutputWriter *output);
 
 bool should_skip_repeated_empty_lines(int character, int *empty_line_count);
 
@@ -2,16 +2,32 @@
 #include <stdio.h>    // Стандартный ввод/вывод
 #include <stdlib.h>  // Стандартная библиотека (EXIT_SUCCESS и др.)
 #include <string.h>  // Функции работы со строками
-#include <unistd.h>  // Для системных вызовов (popen и др.)
+
+#include "s21_bench.h"  // Генерация больших наборов файлов
+#include "s21_test.h"   // Параллельный запуск и сравнение вывода
 
 // Максимальное количество флагов для тестирования
 #define MAX_FLAGS 8
-// Размер буфера для хранения вывода команд
-#define BUFFER_SIZE 8192
-#define TEST_FILES "1.txt 2.txt 3.txt 4.txt 5.txt"
+// Количество тестовых файлов
+#define TEST_FILE_COUNT 5
 // Массив тестируемых флагов программы cat
 const char *flags[] = {"-b", "-e", "-n", "-s", "-t", "-v", "-E", "-T"};
-// Строка с именами тестовых файлов через пробел
+// Имена тестовых файлов
+char *test_files[TEST_FILE_COUNT] = {"1.txt", "2.txt", "3.txt", "4.txt",
+                                     "5.txt"};
+
+// Проверки на больших сгенерированных наборах (флаг --large)
+const BenchCase large_cases[] = {
+    {"", NULL, CORPUS_HUGE},
+    {"-n", NULL, CORPUS_HUGE},
+    {"-b -e", NULL, CORPUS_HUGE},
+    {"-s -t", NULL, CORPUS_HUGE},
+    {"-b -e -n -s -t -v", NULL, CORPUS_HUGE},
+    {"-n", NULL, CORPUS_SMALL_FILES},
+    {"-e", NULL, CORPUS_LONG_LINES},
+    {"-v", NULL, CORPUS_BINARY},
+    {"-e -t", NULL, CORPUS_BINARY},
+};
 
 /**
  * Создает тестовые файлы с различными типами содержимого:
@@ -52,107 +68,88 @@ void create_test_files() {
 }
 
 /**
- * Выполняет команду в shell и возвращает ее вывод
- * @param cmd Команда для выполнения
- * @return Указатель на статический буфер с выводом команды
- *
- * Особенности:
- * - Использует статический буфер (не потокобезопасно)
- * - Возвращает "CMD ERROR" при ошибке выполнения
- * - Читает вывод команды порциями по 256 байт
- */
-char *run_cmd(const char *cmd) {
-  // Статический буфер для хранения вывода (общий для всех вызовов)
-  static char output[BUFFER_SIZE];
-  FILE *fp = popen(cmd, "r");  // Открываем pipe для чтения вывода команды
-
-  output[0] = '\0';  // Обнуляем буфер вывода
-
-  if (!fp) return "CMD ERROR";  // Если не удалось выполнить команду
-
-  char buf[256];  // Буфер для чтения вывода порциями
-  // Читаем вывод команды построчно до конца
-  while (fgets(buf, sizeof(buf), fp))
-    strcat(output, buf);  // Добавляем прочитанное в общий вывод
-
-  pclose(fp);  // Закрываем pipe
-  return output;  // Возвращаем указатель на результат
-}
-
-/**
- * Тестирует все возможные комбинации флагов с тестовыми файлами
- * @param verbose Режим подробного вывода (true - выводить все тесты, false -
- * только ошибки)
+ * Добавляет проверки всех возможных комбинаций флагов с тестовыми файлами
+ * @param suite Набор проверок
+ * @return false при нехватке памяти
  *
  * Алгоритм работы:
  * 1. Перебираем все возможные комбинации флагов (2^8 - 1 вариантов)
- * 2. Для каждой комбинации:
- *    - Формируем команды для system cat и s21_cat
- *    - Выполняем обе команды
- *    - Сравниваем вывод
- * 3. Подсчитываем и выводим статистику
+ * 2. Для каждой комбинации добавляем проверку: system cat и s21_cat
+ *    запускаются одновременно, вывод сравнивается по мере поступления
  */
-void test_all_combinations(bool verbose) {
-  int passed = 0, total = 0;  // Счетчики успешных и всех тестов
+bool add_all_combinations(TestSuite *suite) {
+  bool ok = true;  // Признак успешного добавления
 
   // Перебираем все комбинации флагов (от 1 до 2^MAX_FLAGS - 1)
-  for (int mask = 1; mask < (1 << MAX_FLAGS); mask++) {
+  for (int mask = 1; ok && mask < (1 << MAX_FLAGS); mask++) {
     char flags_str[100] = "";  // Буфер для хранения комбинации флагов
 
     // Формируем строку флагов для текущей комбинации
     for (int i = 0; i < MAX_FLAGS; i++) {
       if (mask & (1 << i)) {  // Если флаг включен в текущую комбинацию
-        strcat(flags_str, flags[i]);  // Добавляем флаг
-        strcat(flags_str, " ");       // И пробел после него
+        if (flags_str[0] != '\0') strcat(flags_str, " ");  // Разделитель
+        strcat(flags_str, flags[i]);                       // Добавляем флаг
       }
     }
 
-    // Формируем команды для system cat и s21_cat
-    char sys_cmd[BUFFER_SIZE], custom_cmd[BUFFER_SIZE];
-    snprintf(sys_cmd, sizeof(sys_cmd), "cat %s %s", flags_str, TEST_FILES);
-    snprintf(custom_cmd, sizeof(custom_cmd), "./s21_cat %s %s", flags_str,
-             TEST_FILES);
-
-    // В подробном режиме выводим текущую тестируемую команду
-    if (verbose) printf("Testing: %s\n", custom_cmd);
-
-    // Выполняем обе команды и получаем их вывод
-    char *sys_out = run_cmd(sys_cmd);
-    char *custom_out = run_cmd(custom_cmd);
-
-    total++;  // Увеличиваем счетчик всех тестов
-
-    // Сравниваем вывод system cat и s21_cat
-    if (strcmp(sys_out, custom_out) == 0) {
-      passed++;  // Если вывод совпадает, увеличиваем счетчик успешных
-    } else {
-      printf("FAIL: %s\n", custom_cmd);
-      printf("Expected (system cat):\n%s\nGot (s21_cat):\n%s\n\n", sys_out,
-             custom_out);
-    }
+    // Добавляем проверку для system cat и s21_cat
+    ok = add_test_case(suite, "cat", "./s21_cat", flags_str, test_files,
+                       TEST_FILE_COUNT);
   }
+  return ok;
+}
 
-  // Выводим итоговую статистику
-  printf("\nResults: %d/%d passed (%.1f%%)\n", passed, total,
-         (float)passed / total * 100);
+/**
+ * Добавляет проверки на больших сгенерированных наборах (флаг --large)
+ * @param suite Набор проверок
+ * @param corpora Сгенерированные наборы файлов
+ * @return false при нехватке памяти
+ */
+bool add_large_cases(TestSuite *suite, const BenchCorpus *corpora) {
+  bool ok = true;
+  size_t count = sizeof(large_cases) / sizeof(large_cases[0]);
+
+  for (size_t i = 0; ok && i < count; i++) {
+    const BenchCorpus *corpus = &corpora[large_cases[i].corpus];
+    ok = add_test_case(suite, "cat", "./s21_cat", large_cases[i].flags,
+                       corpus->paths, corpus->count);
+  }
+  return ok;
 }
 
 /**
  * Точка входа в программу
  * @param argc Количество аргументов командной строки
  * @param argv Массив аргументов командной строки
+ * @return 0 если все проверки пройдены, иначе 1
  *
  * Использование:
- *   ./test      - обычный режим (вывод только ошибок)
- *   ./test +    - подробный режим (вывод всех тестов)
+ *   ./test               - обычный режим (вывод только ошибок)
+ *   ./test +             - подробный режим (вывод всех тестов)
+ *   ./test -j 4          - число параллельных проверок (по умолчанию
+ *                          по числу ядер)
+ *   ./test --large 256   - дополнительно проверить наборы по 256 МБ
  */
 int main(int argc, char **argv) {
+  TestSuite suite;  // Набор проверок и параметры запуска
+  if (!init_test_suite(&suite, argc, argv)) return EXIT_FAILURE;
+
   // Создаем тестовые файлы (если их нет)
   create_test_files();
 
-  // Запускаем тестирование в выбранном режиме
-  // Если есть аргумент "+" - подробный режим, иначе - обычный
-  test_all_combinations(argc > 1 && strcmp(argv[1], "+") == 0);
+  // Собираем проверки; большие наборы генерируются только по запросу
+  BenchCorpus corpora[CORPUS_COUNT] = {0};
+  bool ok = add_all_combinations(&suite);
+  if (ok && suite.large_mb > 0) {
+    ok = generate_corpora(suite.large_mb, corpora) &&
+         add_large_cases(&suite, corpora);
+  }
 
-  return 0;  // Успешное завершение
-}
\ No newline at end of file
+  // Запускаем проверки параллельно и выводим итог
+  size_t failed = ok ? run_test_suite(&suite) : 1;
+  if (!ok) fprintf(stderr, "Ошибка: Не удалось подготовить проверки\n");
+
+  free_test_suite(&suite);
+  free_corpora(corpora);
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
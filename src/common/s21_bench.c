@@ -0,0 +1,496 @@
+#include "s21_bench.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_PATH_SIZE 256
+#define BENCH_FLAGS_SIZE 256
+#define MEGABYTE (1024 * 1024)
+
+static const char* const kWords[] = {
+    "request", "handler", "session", "timeout", "connection", "user",
+    "cache",   "query",   "commit",  "socket",  "payload",    "token",
+    "retry",   "worker",  "shard",   "index"};
+static const char* const kComponents[] = {"api", "db", "auth", "queue",
+                                          "storage"};
+
+/* Генератор псевдослучайных чисел xorshift64*: одинаковое начальное
+ * значение дает одинаковые наборы на любой машине */
+typedef struct {
+  uint64_t state;
+} BenchRandom;
+
+/**
+ * Следующее псевдослучайное число
+ * @param random Состояние генератора
+ * @return Число
+ */
+static uint64_t next_random(BenchRandom* random) {
+  random->state ^= random->state >> 12;
+  random->state ^= random->state << 25;
+  random->state ^= random->state >> 27;
+  return random->state * 0x2545F4914F6CDD1Dull;
+}
+
+/**
+ * Запись одной строки журнала. Уровни распределены так, чтобы были и
+ * частые (INFO), и редкие (FATAL, примерно одна строка из 100000)
+ * совпадения
+ * @param file Файл
+ * @param random Генератор
+ * @param line Номер строки
+ * @return Количество записанных байт
+ */
+static size_t write_log_line(FILE* file, BenchRandom* random, size_t line) {
+  uint64_t roll = next_random(random) % 100000;
+  const char* level = "INFO";
+  if (roll < 30000) level = "WARN";
+  if (roll < 10000) level = "ERROR";
+  if (roll == 0) level = "FATAL";
+  size_t words = 4 + next_random(random) % 9;
+  const size_t component_count = sizeof(kComponents) / sizeof(kComponents[0]);
+  const size_t word_count = sizeof(kWords) / sizeof(kWords[0]);
+
+  int written = fprintf(
+      file, "2024-03-%02zu %02zu:%02zu:%02zu [%s] %s:", 1 + line / 86400 % 28,
+      line / 3600 % 24, line / 60 % 60, line % 60, level,
+      kComponents[next_random(random) % component_count]);
+  size_t bytes = written > 0 ? (size_t)written : 0;
+  for (size_t i = 0; i < words; i++) {
+    const char* word = kWords[next_random(random) % word_count];
+    fputc(' ', file);
+    fputs(word, file);
+    bytes += 1 + strlen(word);
+  }
+  written = fprintf(file, " took %lums\n",
+                    (unsigned long)(next_random(random) % 5000));
+  return bytes + (written > 0 ? (size_t)written : 0);
+}
+
+/**
+ * Создание файла журнала заданного размера
+ * @param path Путь к файлу
+ * @param size Размер в байтах (округляется вверх до целой строки)
+ * @param seed Начальное значение генератора
+ * @return Фактический размер или 0 при ошибке
+ */
+static size_t write_log_file(const char* path, size_t size, uint64_t seed) {
+  FILE* file = fopen(path, "w");
+  if (file == NULL) return 0;
+  BenchRandom random = {seed};
+  size_t bytes = 0;
+  for (size_t line = 0; bytes < size; line++) {
+    bytes += write_log_line(file, &random, line);
+  }
+  return fclose(file) == 0 ? bytes : 0;
+}
+
+/**
+ * Создание файла со строками длиной около мегабайта. Слово "needle"
+ * встречается в среднем около раза на строку
+ * @param path Путь к файлу
+ * @param size Размер в байтах
+ * @return Фактический размер или 0 при ошибке
+ */
+static size_t write_long_lines(const char* path, size_t size) {
+  FILE* file = fopen(path, "w");
+  if (file == NULL) return 0;
+  BenchRandom random = {0x10c5};
+  const size_t word_count = sizeof(kWords) / sizeof(kWords[0]);
+  size_t bytes = 0;
+  size_t line_bytes = 0;
+  while (bytes < size) {
+    const char* word = next_random(&random) % 100000 == 0
+                           ? "needle"
+                           : kWords[next_random(&random) % word_count];
+    size_t length = strlen(word);
+    fputs(word, file);
+    line_bytes += length + 1;
+    bool end_of_line = line_bytes >= MEGABYTE;
+    fputc(end_of_line ? '\n' : ' ', file);
+    if (end_of_line) line_bytes = 0;
+    bytes += length + 1;
+  }
+  return fclose(file) == 0 ? bytes : 0;
+}
+
+/**
+ * Создание файла случайных байт (в нем есть нули и управляющие символы)
+ * @param path Путь к файлу
+ * @param size Размер в байтах
+ * @return Фактический размер или 0 при ошибке
+ */
+static size_t write_binary(const char* path, size_t size) {
+  FILE* file = fopen(path, "w");
+  if (file == NULL) return 0;
+  BenchRandom random = {0xb1a7};
+  uint64_t block[1024];
+  size_t bytes = 0;
+  while (bytes < size) {
+    for (size_t i = 0; i < sizeof(block) / sizeof(block[0]); i++) {
+      block[i] = next_random(&random);
+    }
+    bytes += fwrite(block, 1, sizeof(block), file);
+  }
+  return fclose(file) == 0 ? bytes : 0;
+}
+
+/**
+ * Добавление файла в набор
+ * @param corpus Набор
+ * @param path Путь к файлу
+ * @param bytes Размер файла (0 - ошибка создания)
+ * @return false при ошибке
+ */
+static bool add_corpus_file(BenchCorpus* corpus, const char* path,
+                            size_t bytes) {
+  char* copy = strdup(path);
+  if (copy == NULL || bytes == 0) {
+    free(copy);
+    return false;
+  }
+  corpus->paths[corpus->count++] = copy;
+  corpus->bytes += bytes;
+  return true;
+}
+
+/**
+ * Генерация всех наборов в каталоге BENCH_CORPUS_DIR. Содержимое зависит
+ * только от размера, поэтому результаты разных запусков сравнимы
+ * @param size_mb Размер большого файла в мегабайтах (остальные наборы
+ *        пропорционально меньше)
+ * @param corpora Массив из CORPUS_COUNT наборов для заполнения
+ * @return false при ошибке записи
+ */
+bool generate_corpora(size_t size_mb, BenchCorpus* corpora) {
+  static const char* const kNames[CORPUS_COUNT] = {"huge", "small_files",
+                                                   "long_lines", "binary"};
+  size_t size = size_mb * MEGABYTE;
+  size_t side_size = size / 4 > MEGABYTE ? size / 4 : MEGABYTE;
+  char path[BENCH_PATH_SIZE];
+  bool ok = true;
+
+  mkdir(BENCH_CORPUS_DIR, 0755);
+  mkdir(BENCH_CORPUS_DIR "/small", 0755);
+  for (int kind = 0; kind < CORPUS_COUNT; kind++) {
+    size_t capacity = kind == CORPUS_SMALL_FILES ? BENCH_SMALL_FILE_COUNT : 1;
+    corpora[kind] = (BenchCorpus){kNames[kind], NULL, 0, 0};
+    corpora[kind].paths = calloc(capacity, sizeof(char*));
+    ok = ok && corpora[kind].paths != NULL;
+  }
+  if (!ok) return false;
+
+  snprintf(path, sizeof(path), "%s/huge.log", BENCH_CORPUS_DIR);
+  ok = add_corpus_file(&corpora[CORPUS_HUGE], path,
+                       write_log_file(path, size, 0x5eed));
+  for (size_t i = 0; ok && i < BENCH_SMALL_FILE_COUNT; i++) {
+    snprintf(path, sizeof(path), "%s/small/%04zu.log", BENCH_CORPUS_DIR, i);
+    ok = add_corpus_file(&corpora[CORPUS_SMALL_FILES], path,
+                         write_log_file(path, 4096, 0x5eed + i + 1));
+  }
+  snprintf(path, sizeof(path), "%s/long_lines.txt", BENCH_CORPUS_DIR);
+  ok = ok && add_corpus_file(&corpora[CORPUS_LONG_LINES], path,
+                             write_long_lines(path, side_size));
+  snprintf(path, sizeof(path), "%s/binary.bin", BENCH_CORPUS_DIR);
+  ok = ok && add_corpus_file(&corpora[CORPUS_BINARY], path,
+                             write_binary(path, side_size));
+  return ok;
+}
+
+/**
+ * Освобождение списков файлов (сами файлы остаются на диске)
+ * @param corpora Массив из CORPUS_COUNT наборов
+ */
+void free_corpora(BenchCorpus* corpora) {
+  for (int kind = 0; kind < CORPUS_COUNT; kind++) {
+    for (size_t i = 0; i < corpora[kind].count; i++) {
+      free(corpora[kind].paths[i]);
+    }
+    free(corpora[kind].paths);
+    corpora[kind].paths = NULL;
+  }
+}
+
+/**
+ * Формирование аргументов команды: программа, флаги (через пробел),
+ * шаблон и все файлы набора. Строки флагов хранятся в статическом
+ * буфере и действительны до следующего вызова
+ * @param argv Массив из BENCH_MAX_ARGS элементов
+ * @param program Программа
+ * @param flags Флаги через пробел (может быть пустой строкой)
+ * @param pattern Шаблон или NULL
+ * @param corpus Набор файлов
+ * @return Количество аргументов
+ */
+size_t build_bench_argv(char** argv, const char* program, const char* flags,
+                        const char* pattern, const BenchCorpus* corpus) {
+  static char tokens[BENCH_FLAGS_SIZE];
+  size_t count = 0;
+  char* save = NULL;
+
+  snprintf(tokens, sizeof(tokens), "%s", flags);
+  argv[count++] = (char*)program;
+  for (char* token = strtok_r(tokens, " ", &save); token != NULL;
+       token = strtok_r(NULL, " ", &save)) {
+    argv[count++] = token;
+  }
+  if (pattern != NULL) argv[count++] = (char*)pattern;
+  for (size_t i = 0; i < corpus->count && count + 1 < BENCH_MAX_ARGS; i++) {
+    argv[count++] = corpus->paths[i];
+  }
+  argv[count] = NULL;
+  return count;
+}
+
+/**
+ * Запуск команды. Вывод идет в файл в памяти, а не в /dev/null: GNU grep
+ * распознает /dev/null и останавливается на первом совпадении
+ * @param argv Аргументы команды
+ * @param output_fd Файл для вывода (обрезается перед запуском)
+ * @param traced Остановиться перед exec для трассировки
+ * @return Идентификатор процесса или -1
+ */
+static pid_t spawn_command(char** argv, int output_fd, bool traced) {
+  if (ftruncate(output_fd, 0) != 0 || lseek(output_fd, 0, SEEK_SET) != 0) {
+    return -1;
+  }
+  pid_t pid = fork();
+  if (pid == 0) {
+    dup2(output_fd, STDOUT_FILENO);
+    if (traced) {
+      ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+      raise(SIGSTOP);
+    }
+    execvp(argv[0], argv);
+    _exit(127);
+  }
+  return pid;
+}
+
+/**
+ * Код завершения в стиле оболочки
+ * @param status Статус из wait
+ * @return Код завершения или 128 + номер сигнала
+ */
+static int exit_code(int status) {
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+/**
+ * Подсчет системных вызовов через ptrace. Отслеживаются все потоки
+ * процесса; считаются только входы в системные вызовы
+ * @param argv Аргументы команды
+ * @param output_fd Файл для вывода
+ * @param result Результат для заполнения счетчиков
+ * @return false если трассировка недоступна
+ */
+static bool count_syscalls(char** argv, int output_fd, BenchResult* result) {
+#ifdef PTRACE_GET_SYSCALL_INFO
+  int status;
+  pid_t pid = spawn_command(argv, output_fd, true);
+  if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFSTOPPED(status)) {
+    return false;
+  }
+  long options =
+      PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_EXITKILL;
+  if (ptrace(PTRACE_SETOPTIONS, pid, NULL, (void*)options) != 0) {
+    kill(pid, SIGKILL);
+    waitpid(pid, &status, 0);
+    return false;
+  }
+
+  result->syscalls = result->read_calls = result->write_calls = 0;
+  ptrace(PTRACE_SYSCALL, pid, NULL, NULL);
+  pid_t tid;
+  while ((tid = waitpid(-1, &status, __WALL)) > 0) {
+    if (!WIFSTOPPED(status)) continue;
+
+    int injected = WSTOPSIG(status);
+    if (injected == (SIGTRAP | 0x80)) {
+      struct __ptrace_syscall_info info;
+      if (ptrace(PTRACE_GET_SYSCALL_INFO, tid, (void*)sizeof(info), &info) >
+              0 &&
+          info.op == PTRACE_SYSCALL_INFO_ENTRY) {
+        long nr = (long)info.entry.nr;
+        result->syscalls++;
+        result->read_calls +=
+            nr == SYS_read || nr == SYS_readv || nr == SYS_pread64;
+        result->write_calls +=
+            nr == SYS_write || nr == SYS_writev || nr == SYS_pwrite64;
+      }
+      injected = 0;
+    } else if (injected == SIGTRAP || injected == SIGSTOP) {
+      injected = 0;  // События exec/clone и начальная остановка потока
+    }
+    ptrace(PTRACE_SYSCALL, tid, NULL, (void*)(long)injected);
+  }
+  return errno == ECHILD;
+#else
+  (void)argv;
+  (void)output_fd;
+  (void)result;
+  return false;
+#endif
+}
+
+/**
+ * Измерение команды: лучшее время из BENCH_RUNS запусков, пиковая
+ * память по rusage и, по запросу, отдельный запуск под ptrace для
+ * подсчета системных вызовов (трассировка сильно замедляет процесс,
+ * поэтому в измерение времени она не входит)
+ * @param argv Аргументы команды
+ * @param count_syscalls_too Считать системные вызовы
+ * @param result Результат
+ * @return false если команду не удалось запустить
+ */
+bool run_benchmark(char** argv, bool count_syscalls_too, BenchResult* result) {
+  *result = (BenchResult){0, 0, 0, -1, -1, -1, 0};
+  int output_fd = memfd_create("bench_output", 0);
+  if (output_fd < 0) return false;
+
+  for (int run = 0; run < BENCH_RUNS; run++) {
+    struct timespec start, end;
+    struct rusage usage;
+    int status;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    pid_t pid = spawn_command(argv, output_fd, false);
+    if (pid < 0 || wait4(pid, &status, 0, &usage) != pid) {
+      close(output_fd);
+      return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (double)(end.tv_sec - start.tv_sec) +
+                     (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    if (run == 0 || seconds < result->seconds) result->seconds = seconds;
+    if (usage.ru_maxrss > result->peak_rss_kb) {
+      result->peak_rss_kb = usage.ru_maxrss;
+    }
+    result->exit_code = exit_code(status);
+  }
+
+  struct stat output_stat;
+  if (fstat(output_fd, &output_stat) == 0) {
+    result->output_bytes = (size_t)output_stat.st_size;
+  }
+  if (count_syscalls_too && !count_syscalls(argv, output_fd, result)) {
+    result->syscalls = result->read_calls = result->write_calls = -1;
+  }
+  close(output_fd);
+  return result->exit_code != 127;
+}
+
+/**
+ * Вывод строки JSON с экранированием кавычек и обратной косой черты
+ * @param text Строка
+ */
+static void print_json_string(const char* text) {
+  putchar('"');
+  for (; *text != '\0'; text++) {
+    if (*text == '"' || *text == '\\') putchar('\\');
+    putchar(*text);
+  }
+  putchar('"');
+}
+
+/**
+ * Вывод одного результата в формате JSON Lines (одна запись на строку)
+ * @param implementation Название реализации ("s21_grep", "grep", ...)
+ * @param flags Флаги
+ * @param pattern Шаблон или NULL
+ * @param corpus Набор файлов
+ * @param result Результат измерения
+ */
+void print_bench_record(const char* implementation, const char* flags,
+                        const char* pattern, const BenchCorpus* corpus,
+                        const BenchResult* result) {
+  double gbps = result->seconds > 0
+                    ? (double)corpus->bytes / result->seconds / 1e9
+                    : 0.0;
+  printf("{\"impl\":");
+  print_json_string(implementation);
+  printf(",\"flags\":");
+  print_json_string(flags);
+  printf(",\"pattern\":");
+  if (pattern != NULL) {
+    print_json_string(pattern);
+  } else {
+    printf("null");
+  }
+  printf(",\"corpus\":");
+  print_json_string(corpus->name);
+  printf(
+      ",\"files\":%zu,\"bytes\":%zu,\"output_bytes\":%zu,"
+      "\"seconds\":%.6f,\"gbps\":%.3f,\"peak_rss_kb\":%ld,"
+      "\"syscalls\":%ld,\"read_calls\":%ld,\"write_calls\":%ld,"
+      "\"exit\":%d}\n",
+      corpus->count, corpus->bytes, result->output_bytes, result->seconds,
+      gbps, result->peak_rss_kb, result->syscalls, result->read_calls,
+      result->write_calls, result->exit_code);
+  fflush(stdout);
+}
+
+/**
+ * Прогон набора измерений для своей программы и эталонной утилиты GNU.
+ * Аргументы: [размер_МБ] [--no-syscalls]. Результаты печатаются в stdout
+ * в формате JSON Lines, по записи на каждую пару (измерение, реализация)
+ * @param program Путь к своей программе ("./s21_grep")
+ * @param reference Эталонная утилита ("grep")
+ * @param cases Измерения
+ * @param case_count Количество измерений
+ * @param argc Количество аргументов командной строки
+ * @param argv Аргументы командной строки
+ * @return Код завершения
+ */
+int run_bench_suite(const char* program, const char* reference,
+                    const BenchCase* cases, size_t case_count, int argc,
+                    char** argv) {
+  size_t size_mb = BENCH_DEFAULT_SIZE_MB;
+  bool syscalls = true;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--no-syscalls") == 0) {
+      syscalls = false;
+    } else if (atoi(argv[i]) > 0) {
+      size_mb = (size_t)atoi(argv[i]);
+    }
+  }
+
+  BenchCorpus corpora[CORPUS_COUNT];
+  if (!generate_corpora(size_mb, corpora)) {
+    fprintf(stderr, "Ошибка: Не удалось создать файлы в %s\n",
+            BENCH_CORPUS_DIR);
+    free_corpora(corpora);
+    return EXIT_FAILURE;
+  }
+
+  const char* implementations[] = {program, reference};
+  char* command[BENCH_MAX_ARGS];
+  for (size_t i = 0; i < case_count; i++) {
+    const BenchCase* bench = &cases[i];
+    for (size_t impl = 0; impl < 2; impl++) {
+      BenchResult result;
+      build_bench_argv(command, implementations[impl], bench->flags,
+                       bench->pattern, &corpora[bench->corpus]);
+      if (run_benchmark(command, syscalls, &result)) {
+        print_bench_record(implementations[impl], bench->flags,
+                           bench->pattern, &corpora[bench->corpus], &result);
+      }
+    }
+  }
+
+  free_corpora(corpora);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+#ifndef SRC_COMMON_S21_BENCH_H_
+#define SRC_COMMON_S21_BENCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define BENCH_CORPUS_DIR "bench_corpus"
+#define BENCH_DEFAULT_SIZE_MB 64
+#define BENCH_RUNS 3
+#define BENCH_SMALL_FILE_COUNT 1000
+#define BENCH_MAX_ARGS (BENCH_SMALL_FILE_COUNT + 16)
+
+/* Наборы входных данных */
+typedef enum {
+  CORPUS_HUGE,         // Один большой файл журнала
+  CORPUS_SMALL_FILES,  // Много маленьких файлов
+  CORPUS_LONG_LINES,   // Строки длиной около мегабайта
+  CORPUS_BINARY,       // Случайные байты с нулями
+  CORPUS_COUNT
+} CorpusKind;
+
+/* Сгенерированный набор: список файлов и их общий размер */
+typedef struct {
+  const char* name;
+  char** paths;
+  size_t count;
+  size_t bytes;
+} BenchCorpus;
+
+/* Одно измерение: флаги через пробел, шаблон (NULL для cat) и набор */
+typedef struct {
+  const char* flags;
+  const char* pattern;
+  CorpusKind corpus;
+} BenchCase;
+
+/* Результат измерения одной команды */
+typedef struct {
+  double seconds;      // Лучшее время из BENCH_RUNS запусков
+  size_t output_bytes;  // Объем вывода
+  long peak_rss_kb;    // Пиковый объем памяти процесса
+  long syscalls;       // Все системные вызовы (-1 если не считались)
+  long read_calls;     // read, readv, pread64
+  long write_calls;    // write, writev, pwrite64
+  int exit_code;       // Код завершения последнего запуска
+} BenchResult;
+
+bool generate_corpora(size_t size_mb, BenchCorpus* corpora);
+void free_corpora(BenchCorpus* corpora);
+size_t build_bench_argv(char** argv, const char* program, const char* flags,
+                        const char* pattern, const BenchCorpus* corpus);
+bool run_benchmark(char** argv, bool count_syscalls, BenchResult* result);
+void print_bench_record(const char* implementation, const char* flags,
+                        const char* pattern, const BenchCorpus* corpus,
+                        const BenchResult* result);
+int run_bench_suite(const char* program, const char* reference,
+                    const BenchCase* cases, size_t case_count, int argc,
+                    char** argv);
+
+#endif  // SRC_COMMON_S21_BENCH_H_
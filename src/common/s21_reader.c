@@ -0,0 +1,411 @@
+#include "s21_reader.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "s21_stats.h"
+
+#define SWAR_ONES 0x0101010101010101ull
+#define SWAR_LOW_BITS 0x7f7f7f7f7f7f7f7full
+#define SWAR_HIGH_BITS 0x8080808080808080ull
+
+/* Отображение файла, защищенное от SIGBUS (см. map_guarded_file).
+ * Обработчик сигнала читает записи без блокировок, поэтому все поля
+ * атомарные; start публикуется последним и снимается первым */
+typedef struct {
+  atomic_bool used;
+  atomic_uintptr_t start;
+  atomic_size_t size;
+  volatile sig_atomic_t truncated;  // Вместо страницы вставлены нули
+} GuardedMapping;
+
+static GuardedMapping guarded_mappings[GUARD_MAX_MAPPINGS];
+static size_t guard_page_size;
+static atomic_bool guard_installed;
+
+/**
+ * Поиск защищенного отображения, в которое попадает адрес
+ * @param address Адрес
+ * @return Номер записи или -1
+ */
+static int find_guarded_mapping(uintptr_t address) {
+  for (int i = 0; i < GUARD_MAX_MAPPINGS; i++) {
+    uintptr_t start = atomic_load(&guarded_mappings[i].start);
+    if (start != 0 && address >= start &&
+        address - start < atomic_load(&guarded_mappings[i].size)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Обработчик SIGBUS при обращении к защищенному отображению за концом
+ * файла (файл укоротили во время чтения). Вместо пропавшей страницы
+ * отображается страница нулей, запись отображения помечается, и
+ * чтение продолжается. Выход через longjmp из regexec или memchr
+ * оставил бы их состояние несогласованным. mmap здесь - прямой
+ * системный вызов без общего состояния libc, кроме errno, которое
+ * сохраняется. Любой другой SIGBUS получает действие по умолчанию, и
+ * повтор инструкции завершает процесс как обычно
+ */
+static void replace_missing_page(int signal_number, siginfo_t* info,
+                                 void* context) {
+  (void)context;
+  int saved_errno = errno;
+  uintptr_t address = (uintptr_t)info->si_addr;
+  int guard = info->si_code == BUS_ADRERR ? find_guarded_mapping(address)
+                                          : -1;
+  if (guard >= 0 &&
+      mmap((void*)(address & ~(guard_page_size - 1)), guard_page_size,
+           PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1,
+           0) != MAP_FAILED) {
+    guarded_mappings[guard].truncated = 1;
+  } else {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    sigaction(signal_number, &action, NULL);
+  }
+  errno = saved_errno;
+}
+
+/**
+ * Установка обработчика SIGBUS (один раз на процесс)
+ */
+static void install_guard_handler(void) {
+  if (atomic_load(&guard_installed)) return;
+  guard_page_size = (size_t)sysconf(_SC_PAGESIZE);
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = replace_missing_page;
+  action.sa_flags = SA_SIGINFO;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGBUS, &action, NULL);
+  atomic_store(&guard_installed, true);
+}
+
+/**
+ * Отображение файла, который могут укоротить во время чтения. Страницы
+ * за новым концом файла читаются как нули, а guarded_mapping_truncated
+ * сообщает об этом. Если все GUARD_MAX_MAPPINGS записей заняты, файл не
+ * отображается: вызывающий читает его другим способом
+ * @param fd Дескриптор файла
+ * @param size Размер отображения
+ * @param guard Номер записи для остальных функций
+ * @return Начало отображения или NULL
+ */
+void* map_guarded_file(int fd, size_t size, int* guard) {
+  install_guard_handler();
+  *guard = -1;
+  for (int i = 0; *guard < 0 && i < GUARD_MAX_MAPPINGS; i++) {
+    bool expected = false;
+    if (atomic_compare_exchange_strong(&guarded_mappings[i].used, &expected,
+                                       true)) {
+      *guard = i;
+    }
+  }
+  if (*guard < 0) return NULL;
+
+  void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    atomic_store(&guarded_mappings[*guard].used, false);
+    *guard = -1;
+    return NULL;
+  }
+  GuardedMapping* mapping = &guarded_mappings[*guard];
+  mapping->truncated = 0;
+  atomic_store(&mapping->size, size);
+  atomic_store(&mapping->start, (uintptr_t)data);
+  return data;
+}
+
+/**
+ * Снятие защиты и отображения
+ * @param data Начало отображения
+ * @param size Размер отображения
+ * @param guard Номер записи из map_guarded_file
+ */
+void unmap_guarded_file(void* data, size_t size, int guard) {
+  atomic_store(&guarded_mappings[guard].start, 0);
+  munmap(data, size);
+  atomic_store(&guarded_mappings[guard].used, false);
+}
+
+/**
+ * Вставлялись ли нули вместо страниц отображения. Проверка не требует
+ * системного вызова, поэтому выполняется перед каждым блоком
+ * @param guard Номер записи из map_guarded_file
+ * @return true если файл укоротили
+ */
+bool guarded_mapping_truncated(int guard) {
+  return guarded_mappings[guard].truncated != 0;
+}
+
+/**
+ * Проверка, не стал ли отображенный файл короче отображения. Нужна в
+ * конце файла: байты за новым концом внутри последней страницы читаются
+ * как нули без SIGBUS
+ * @param fd Дескриптор файла
+ * @param size Размер отображения
+ * @return true если файл укоротили
+ */
+bool mapped_file_shrank(int fd, size_t size) {
+  struct stat file_stat;
+  return fstat(fd, &file_stat) == 0 && (size_t)file_stat.st_size < size;
+}
+
+/**
+ * Отображение обычного файла в память
+ * @param reader Состояние чтения (fd уже заполнен)
+ * @return true если файл отображен
+ */
+static bool map_regular_file(BlockReader* reader) {
+  struct stat file_stat;
+  if (reader->fd < 0 || fstat(reader->fd, &file_stat) != 0 ||
+      !S_ISREG(file_stat.st_mode) || file_stat.st_size <= 0) {
+    return false;
+  }
+
+  // Чтение начинается с текущей позиции: stdin мог быть частично прочитан
+  off_t offset = lseek(reader->fd, 0, SEEK_CUR);
+  if (offset != 0) return false;
+
+  size_t size = (size_t)file_stat.st_size;
+  void* data = map_guarded_file(reader->fd, size, &reader->guard);
+  if (data == NULL) return false;
+  madvise(data, size, MADV_SEQUENTIAL);
+  stats_add(STAT_MAPPED_FILES, 1);
+
+  reader->source = SOURCE_MMAP;
+  reader->data = data;
+  reader->capacity = size;
+  reader->length = size;
+  return true;
+}
+
+/**
+ * Инициализация блочного чтения. Обычный файл отображается в память,
+ * остальные файлы с дескриптором (каналы, терминал, stdin) читаются
+ * через read, потоки без дескриптора - через fread
+ * @param reader Структура для заполнения
+ * @param file Открытый файл, из которого еще ничего не прочитано
+ * @param whole_lines Выравнивать блоки по концу строки
+ * @return false если не удалось выделить буфер
+ */
+bool init_block_reader(BlockReader* reader, FILE* file, bool whole_lines) {
+  memset(reader, 0, sizeof(BlockReader));
+  reader->file = file;
+  reader->fd = fileno(file);
+  reader->whole_lines = whole_lines;
+  if (map_regular_file(reader)) return true;
+
+  reader->source = reader->fd >= 0 ? SOURCE_READ : SOURCE_STREAM;
+  reader->data = malloc(READ_BLOCK_SIZE);
+  reader->capacity = READ_BLOCK_SIZE;
+  return reader->data != NULL;
+}
+
+/**
+ * Следующий блок отображенного файла: не длиннее READ_BLOCK_SIZE, а
+ * при выравнивании по строкам - до последнего '\n' в этих пределах
+ * (слишком длинная строка отдается целиком). Если файл укоротили, в
+ * предыдущем блоке могли оказаться нули вместо данных, поэтому чтение
+ * прекращается с ошибкой
+ * @param reader Состояние чтения
+ * @param block Начало блока
+ * @param length Длина блока
+ * @return false если данные закончились или файл укоротили
+ */
+static bool read_mapped_block(BlockReader* reader, const char** block,
+                              size_t* length) {
+  size_t start = reader->consumed;
+  size_t end = reader->length;
+  if (guarded_mapping_truncated(reader->guard) ||
+      (start == end && mapped_file_shrank(reader->fd, reader->length))) {
+    reader->failed = reader->truncated = true;
+    return false;
+  }
+
+  if (end - start > READ_BLOCK_SIZE) {
+    end = start + READ_BLOCK_SIZE;
+    if (reader->whole_lines) {
+      const char* newline = memrchr(reader->data + start, '\n', end - start);
+      if (newline == NULL) {
+        newline = memchr(reader->data + end, '\n', reader->length - end);
+      }
+      end = newline ? (size_t)(newline - reader->data) + 1 : reader->length;
+    }
+  }
+
+  reader->consumed = end;
+  *block = reader->data + start;
+  *length = end - start;
+  stats_add(STAT_BYTES_READ, end - start);
+  stats_add(STAT_BYTES_MAPPED, end - start);
+  return end > start;
+}
+
+/**
+ * Чтение очередной порции в свободную часть буфера
+ * @param reader Состояние чтения
+ * @return Количество прочитанных байт (0 в конце данных и при ошибке)
+ */
+static size_t fill_buffer(BlockReader* reader) {
+  char* target = reader->data + reader->length;
+  size_t space = reader->capacity - reader->length;
+  size_t read_size = 0;
+  uint64_t started = stats_start();
+
+  if (reader->source == SOURCE_STREAM) {
+    read_size = fread(target, 1, space, reader->file);
+    if (read_size == 0 && ferror(reader->file)) reader->failed = true;
+  } else {
+    ssize_t result;
+    do {
+      result = read(reader->fd, target, space);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) reader->failed = true;
+    read_size = result > 0 ? (size_t)result : 0;
+  }
+  if (read_size == 0) reader->eof = true;
+  stats_stop(TIMER_READ_WAIT, started);
+  stats_add(STAT_READ_CALLS, 1);
+  stats_add(STAT_BYTES_READ, read_size);
+  return read_size;
+}
+
+/**
+ * Чтение следующего блока. Без выравнивания блок - это одна порция
+ * read/fread. С выравниванием неполная последняя строка блока переносится
+ * в начало буфера; если строка длиннее буфера, он растет
+ * @param reader Состояние чтения
+ * @param block Начало блока (действительно до следующего вызова)
+ * @param length Длина блока
+ * @return false если данные закончились
+ */
+bool read_block(BlockReader* reader, const char** block, size_t* length) {
+  if (reader->source == SOURCE_MMAP) {
+    return read_mapped_block(reader, block, length);
+  }
+
+  reader->length -= reader->consumed;
+  memmove(reader->data, reader->data + reader->consumed, reader->length);
+  reader->consumed = 0;
+
+  while (!reader->eof) {
+    if (reader->length == reader->capacity) {
+      char* grown = realloc(reader->data, reader->capacity * 2);
+      if (grown == NULL) {
+        reader->eof = reader->failed = true;
+        break;
+      }
+      reader->data = grown;
+      reader->capacity *= 2;
+    }
+
+    size_t scanned = reader->length;
+    reader->length += fill_buffer(reader);
+    if (!reader->whole_lines) {
+      reader->consumed = reader->length;
+      break;
+    }
+
+    const char* last_newline =
+        memrchr(reader->data + scanned, '\n', reader->length - scanned);
+    if (last_newline != NULL) {
+      reader->consumed = (size_t)(last_newline - reader->data) + 1;
+      break;
+    }
+  }
+
+  if (reader->eof && reader->consumed == 0) reader->consumed = reader->length;
+  *block = reader->data;
+  *length = reader->consumed;
+  return reader->consumed > 0;
+}
+
+/**
+ * Освобождение буфера или отображения (файл не закрывается)
+ * @param reader Состояние чтения
+ */
+void free_block_reader(BlockReader* reader) {
+  if (reader->source == SOURCE_MMAP) {
+    unmap_guarded_file(reader->data, reader->capacity, reader->guard);
+  } else {
+    free(reader->data);
+  }
+  reader->data = NULL;
+}
+
+/**
+ * Начало перебора строк участка памяти
+ * @param lines Состояние перебора
+ * @param data Начало участка
+ * @param length Длина участка
+ */
+void init_line_iterator(LineIterator* lines, const char* data, size_t length) {
+  lines->pos = data;
+  lines->end = data + length;
+}
+
+/**
+ * Следующая строка участка. Последняя строка может не заканчиваться
+ * '\n'; завершающий '\n' участка не порождает пустой строки
+ * @param lines Состояние перебора
+ * @param line Строка (указывает внутрь участка)
+ * @return false если строки закончились
+ */
+bool next_line(LineIterator* lines, LineSpan* line) {
+  if (lines->pos >= lines->end) return false;
+
+  const char* newline = memchr(lines->pos, '\n', lines->end - lines->pos);
+  const char* line_end = newline ? newline : lines->end;
+  line->text = lines->pos;
+  line->length = (size_t)(line_end - lines->pos);
+  lines->pos = newline ? newline + 1 : lines->end;
+  return true;
+}
+
+/**
+ * Подсчет символов '\n' по 8 байт за шаг: после XOR с '\n' искомые байты
+ * становятся нулевыми, а выражение ~(((x & 0x7f..) + 0x7f..) | x)
+ * оставляет старший бит ровно в нулевых байтах
+ * @param data Данные
+ * @param length Длина данных
+ * @return Количество переводов строки
+ */
+size_t count_newlines(const char* data, size_t length) {
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    uint64_t x = word ^ ('\n' * SWAR_ONES);
+    uint64_t zero = ~(((x & SWAR_LOW_BITS) + SWAR_LOW_BITS) | x);
+    count += (size_t)__builtin_popcountll(zero & SWAR_HIGH_BITS);
+  }
+  for (; i < length; i++) count += data[i] == '\n';
+  return count;
+}
+
+/**
+ * Количество строк в блоке с учетом последней строки без '\n'
+ * @param data Данные
+ * @param length Длина данных
+ * @return Количество строк
+ */
+size_t count_lines(const char* data, size_t length) {
+  size_t count = count_newlines(data, length);
+  if (length > 0 && data[length - 1] != '\n') count++;
+  return count;
+}
@@ -0,0 +1,61 @@
+#ifndef SRC_COMMON_S21_READER_H_
+#define SRC_COMMON_S21_READER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define READ_BLOCK_SIZE (1 << 20)
+#define GUARD_MAX_MAPPINGS 64  // Одновременно защищенных отображений
+
+/* Способ получения данных, выбирается по открытому файлу */
+typedef enum {
+  SOURCE_MMAP,   // Обычный файл отображается в память целиком
+  SOURCE_READ,   // Канал, терминал, stdin без файла: системный вызов read
+  SOURCE_STREAM  // Поток без дескриптора (распаковка): fread
+} BlockSource;
+
+/* Блочное чтение файла. С whole_lines блок всегда заканчивается '\n',
+ * кроме последнего блока файла без перевода строки. Блок действителен
+ * до следующего вызова read_block */
+typedef struct {
+  BlockSource source;
+  FILE* file;
+  int fd;
+  bool whole_lines;  // Блоки выровнены по концу строки
+  char* data;        // Буфер чтения или отображение файла
+  size_t capacity;
+  size_t length;    // Количество байт в буфере (размер отображения)
+  size_t consumed;  // Количество байт, уже отданных вызывающему
+  bool eof;
+  int guard;       // Запись защищенного отображения (SOURCE_MMAP)
+  bool failed;     // Ошибка чтения
+  bool truncated;  // Отображенный файл укоротили во время чтения
+} BlockReader;
+
+/* Строка внутри блока: указатель и длина без '\n', без копирования и
+ * без завершающего нуля */
+typedef struct {
+  const char* text;
+  size_t length;
+} LineSpan;
+
+/* Перебор строк участка памяти */
+typedef struct {
+  const char* pos;
+  const char* end;
+} LineIterator;
+
+bool init_block_reader(BlockReader* reader, FILE* file, bool whole_lines);
+bool read_block(BlockReader* reader, const char** block, size_t* length);
+void free_block_reader(BlockReader* reader);
+void* map_guarded_file(int fd, size_t size, int* guard);
+void unmap_guarded_file(void* data, size_t size, int guard);
+bool guarded_mapping_truncated(int guard);
+bool mapped_file_shrank(int fd, size_t size);
+void init_line_iterator(LineIterator* lines, const char* data, size_t length);
+bool next_line(LineIterator* lines, LineSpan* line);
+size_t count_newlines(const char* data, size_t length);
+size_t count_lines(const char* data, size_t length);
+
+#endif  // SRC_COMMON_S21_READER_H_
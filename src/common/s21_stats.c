@@ -0,0 +1,157 @@
+#include "s21_stats.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#define NANOSECONDS 1000000000.0
+#define LABEL_WIDTH 24
+
+bool stats_enabled = false;
+_Thread_local StatsBlock thread_stats;
+
+/* Итоги завершившихся потоков. Потоки складывают сюда свои счетчики
+ * один раз при выходе, поэтому атомарные операции не попадают на
+ * горячий путь */
+static _Atomic uint64_t total_counters[STAT_COUNTER_COUNT];
+static _Atomic uint64_t total_timers[STAT_TIMER_COUNT];
+static uint64_t program_start;
+
+/**
+ * Текущее время
+ * @return Наносекунды монотонных часов
+ */
+static uint64_t now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * Включение сбора статистики (флаг --stats)
+ */
+void enable_stats(void) {
+  stats_enabled = true;
+  program_start = now_ns();
+}
+
+/**
+ * Начало замера времени. Без --stats часы не читаются
+ * @return Отметка времени или 0
+ */
+uint64_t stats_start(void) { return stats_enabled ? now_ns() : 0; }
+
+/**
+ * Окончание замера времени
+ * @param timer Замер
+ * @param started Отметка из stats_start
+ */
+void stats_stop(StatTimer timer, uint64_t started) {
+  if (stats_enabled) thread_stats.timers[timer] += now_ns() - started;
+}
+
+/**
+ * Перенос счетчиков текущего потока в общие итоги. Вызывается каждым
+ * рабочим потоком перед выходом и основным потоком перед выводом
+ */
+void merge_thread_stats(void) {
+  for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+    atomic_fetch_add(&total_counters[i], thread_stats.counters[i]);
+  }
+  for (int i = 0; i < STAT_TIMER_COUNT; i++) {
+    atomic_fetch_add(&total_timers[i], thread_stats.timers[i]);
+  }
+  memset(&thread_stats, 0, sizeof(thread_stats));
+}
+
+/**
+ * Вывод подписи, дополненной пробелами до LABEL_WIDTH символов. Ширина
+ * считается в символах UTF-8, а не в байтах, как у printf("%-*s")
+ * @param label Подпись
+ */
+static void print_label(const char* label) {
+  size_t width = 0;
+  for (const char* c = label; *c != '\0'; c++) {
+    if (((unsigned char)*c & 0xc0) != 0x80) width++;
+  }
+  fputs(label, stderr);
+  for (; width < LABEL_WIDTH; width++) fputc(' ', stderr);
+}
+
+/**
+ * Вывод строки со временем
+ * @param label Подпись
+ * @param nanoseconds Время
+ */
+static void print_time(const char* label, uint64_t nanoseconds) {
+  print_label(label);
+  fprintf(stderr, "%.6f с\n", (double)nanoseconds / NANOSECONDS);
+}
+
+/**
+ * Вывод строки со счетчиком
+ * @param label Подпись
+ * @param counter Счетчик
+ */
+static void print_counter(const char* label, StatCounter counter) {
+  print_label(label);
+  fprintf(stderr, "%llu\n",
+          (unsigned long long)atomic_load(&total_counters[counter]));
+}
+
+/**
+ * Вывод сводки в stderr при завершении программы (флаг --stats).
+ * Время обработки включает ожидание ввода-вывода; чтение отображенных
+ * файлов происходит через страничные отказы внутри обработки и в
+ * ожидание чтения не попадает
+ * @param program Имя программы
+ */
+void print_stats(const char* program) {
+  if (!stats_enabled) return;
+  merge_thread_stats();
+
+  uint64_t processing = atomic_load(&total_timers[TIMER_PROCESSING]);
+  uint64_t read_wait = atomic_load(&total_timers[TIMER_READ_WAIT]);
+  uint64_t write_wait = atomic_load(&total_timers[TIMER_WRITE_WAIT]);
+  uint64_t io_wait = read_wait + write_wait;
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  fprintf(stderr, "--- %s: статистика ---\n", program);
+  print_time("время работы:", now_ns() - program_start);
+  print_time("обработка файлов:", processing);
+  print_time("  ожидание чтения:", read_wait);
+  print_time("  ожидание записи:", write_wait);
+  print_time("  вычисления:", processing > io_wait ? processing - io_wait : 0);
+  print_counter("файлов:", STAT_FILES);
+  print_counter("прочитано байт:", STAT_BYTES_READ);
+  print_counter("  через mmap:", STAT_BYTES_MAPPED);
+  print_counter("файлов в mmap:", STAT_MAPPED_FILES);
+  print_counter("вызовов read:", STAT_READ_CALLS);
+  print_counter("вызовов writev:", STAT_WRITE_CALLS);
+  print_counter("выведено байт:", STAT_BYTES_WRITTEN);
+  print_counter("просмотрено строк:", STAT_LINES_SCANNED);
+
+  if (atomic_load(&total_counters[STAT_REGEX_COMPILES]) > 0 ||
+      atomic_load(&total_counters[STAT_LITERAL_SEARCHES]) > 0) {
+    print_counter("компиляций regcomp:", STAT_REGEX_COMPILES);
+    print_counter("  из кэша шаблонов:", STAT_PATTERN_CACHE_HITS);
+    print_time("  время компиляции:",
+               atomic_load(&total_timers[TIMER_REGEX_COMPILE]));
+    print_counter("вызовов regexec:", STAT_REGEXEC_CALLS);
+    print_counter("поисков memmem:", STAT_LITERAL_SEARCHES);
+  }
+
+  uint64_t checks = atomic_load(&total_counters[STAT_PREFILTER_CHECKS]);
+  if (checks > 0) {
+    uint64_t skipped = atomic_load(&total_counters[STAT_PREFILTER_SKIPPED]);
+    print_label("отсеяно индексом:");
+    fprintf(stderr, "%llu из %llu (%.1f%%)\n", (unsigned long long)skipped,
+            (unsigned long long)checks,
+            100.0 * (double)skipped / (double)checks);
+  }
+  print_label("пиковая память:");
+  fprintf(stderr, "%ld КБ\n", usage.ru_maxrss);
+}
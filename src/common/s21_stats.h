@@ -0,0 +1,60 @@
+#ifndef SRC_COMMON_S21_STATS_H_
+#define SRC_COMMON_S21_STATS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Счетчики горячего пути */
+typedef enum {
+  STAT_FILES,               // Обработанные файлы
+  STAT_BYTES_READ,          // Байты, отданные BlockReader
+  STAT_BYTES_MAPPED,        // Из них прочитано через отображение в память
+  STAT_MAPPED_FILES,        // Файлы, отображенные в память
+  STAT_READ_CALLS,          // Вызовы read/fread
+  STAT_WRITE_CALLS,         // Вызовы writev
+  STAT_BYTES_WRITTEN,       // Выведенные байты
+  STAT_LINES_SCANNED,       // Просмотренные строки
+  STAT_REGEX_COMPILES,      // Вызовы regcomp
+  STAT_PATTERN_CACHE_HITS,  // Шаблоны, взятые из кэша без компиляции
+  STAT_REGEXEC_CALLS,       // Вызовы regexec
+  STAT_LITERAL_SEARCHES,    // Поиски подстроки (memmem) вместо regexec
+  STAT_PREFILTER_CHECKS,    // Файлы, проверенные по триграммному индексу
+  STAT_PREFILTER_SKIPPED,   // Из них отсеяны без чтения
+  STAT_COUNTER_COUNT
+} StatCounter;
+
+/* Замеры времени в наносекундах */
+typedef enum {
+  TIMER_PROCESSING,     // Обработка файлов (search_in_file, cat)
+  TIMER_READ_WAIT,      // Ожидание read/fread
+  TIMER_WRITE_WAIT,     // Ожидание writev
+  TIMER_REGEX_COMPILE,  // Компиляция выражений
+  STAT_TIMER_COUNT
+} StatTimer;
+
+/* Счетчики одного потока */
+typedef struct {
+  uint64_t counters[STAT_COUNTER_COUNT];
+  uint64_t timers[STAT_TIMER_COUNT];
+} StatsBlock;
+
+extern bool stats_enabled;
+extern _Thread_local StatsBlock thread_stats;
+
+void enable_stats(void);
+uint64_t stats_start(void);
+void stats_stop(StatTimer timer, uint64_t started);
+void merge_thread_stats(void);
+void print_stats(const char* program);
+
+/**
+ * Увеличение счетчика текущего потока. Без блокировок и проверок:
+ * сложение в локальной памяти потока дешевле любой синхронизации
+ * @param counter Счетчик
+ * @param value Приращение
+ */
+static inline void stats_add(StatCounter counter, uint64_t value) {
+  thread_stats.counters[counter] += value;
+}
+
+#endif  // SRC_COMMON_S21_STATS_H_
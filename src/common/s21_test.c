@@ -0,0 +1,657 @@
+#include "s21_test.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <spawn.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "s21_reader.h"
+
+/* Вывод одной команды: канал и еще не сравненная часть */
+typedef struct {
+  int fd;  // -1 после конца вывода
+  pid_t pid;
+  char* data;     // Окно из TEST_WINDOW_SIZE байт
+  size_t length;  // Байт в окне
+  size_t total;   // Всего байт вывода
+} TestStream;
+
+/* Состояние сравнения двух выводов. Первые checked байт обоих окон
+ * совпадают; окна начинаются с начала строки, пока строка помещается */
+typedef struct {
+  TestStream streams[2];  // Эталон и своя программа
+  size_t checked;
+  size_t discarded;  // Байт, уже сравненных и выброшенных из окон
+  size_t line;       // Номер строки, с которой начинаются окна
+} TestCompare;
+
+/* Общее состояние рабочих потоков */
+typedef struct {
+  const TestSuite* suite;
+  TestResult* results;
+  atomic_size_t next;  // Следующая невзятая проверка
+} TestRunner;
+
+/**
+ * Разбор аргументов тестовой программы: "+" - подробный вывод, -j N -
+ * число параллельных проверок (по умолчанию по числу ядер), --large N -
+ * дополнительные проверки на сгенерированных наборах из N мегабайт
+ * @param suite Набор для инициализации
+ * @param argc Количество аргументов командной строки
+ * @param argv Аргументы командной строки
+ * @return false если аргументы некорректны
+ */
+bool init_test_suite(TestSuite* suite, int argc, char** argv) {
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  memset(suite, 0, sizeof(TestSuite));
+  suite->compare_codes = true;
+  suite->jobs = cores > 0 ? (int)cores : 1;
+
+  bool ok = true;
+  for (int i = 1; ok && i < argc; i++) {
+    if (strcmp(argv[i], "+") == 0) {
+      suite->verbose = true;
+    } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      suite->jobs = atoi(argv[++i]);
+      ok = suite->jobs > 0;
+    } else if (strcmp(argv[i], "--large") == 0 && i + 1 < argc) {
+      int size_mb = atoi(argv[++i]);
+      suite->large_mb = size_mb > 0 ? (size_t)size_mb : 0;
+      ok = size_mb > 0;
+    } else {
+      ok = false;
+    }
+  }
+  if (!ok) {
+    fprintf(stderr, "Использование: %s [+] [-j потоки] [--large МБ]\n",
+            argv[0]);
+  }
+  return ok;
+}
+
+/**
+ * Формирование строки для вывода: программа, аргументы и первые
+ * TEST_TITLE_FILES файлов
+ * @param program Своя программа
+ * @param arguments Аргументы через пробел
+ * @param files Файлы
+ * @param file_count Количество файлов
+ * @return Строка в динамической памяти или NULL
+ */
+static char* build_title(const char* program, const char* arguments,
+                         char* const* files, size_t file_count) {
+  char* title = NULL;
+  size_t size = 0;
+  FILE* stream = open_memstream(&title, &size);
+  if (stream == NULL) return NULL;
+
+  fprintf(stream, "%s %s", program, arguments);
+  for (size_t i = 0; i < file_count && i < TEST_TITLE_FILES; i++) {
+    fprintf(stream, " %s", files[i]);
+  }
+  if (file_count > TEST_TITLE_FILES) {
+    fprintf(stream, " ... (еще %zu)", file_count - TEST_TITLE_FILES);
+  }
+  fclose(stream);
+  return title;
+}
+
+/**
+ * Добавление проверки. Аргументы разбиваются по пробелам без обработки
+ * кавычек: команды запускаются напрямую, без оболочки
+ * @param suite Набор
+ * @param reference Эталонная утилита или NULL, если вывод задан заранее
+ * @param program Своя программа
+ * @param arguments Флаги и шаблоны через пробел
+ * @param files Входные файлы (строки должны жить дольше набора)
+ * @param file_count Количество файлов
+ * @return Добавленная проверка или NULL при нехватке памяти
+ */
+static TestCase* append_test_case(TestSuite* suite, const char* reference,
+                                  const char* program, const char* arguments,
+                                  char* const* files, size_t file_count) {
+  if (suite->count == suite->capacity) {
+    size_t capacity = suite->capacity ? suite->capacity * 2 : 256;
+    TestCase* grown = realloc(suite->cases, capacity * sizeof(TestCase));
+    if (grown == NULL) return NULL;
+    suite->cases = grown;
+    suite->capacity = capacity;
+  }
+
+  size_t words = 1;
+  for (const char* c = arguments; *c != '\0'; c++) words += *c == ' ';
+  size_t argv_size = 1 + words + file_count + 1;
+  TestCase test = {strdup(arguments),
+                   reference ? calloc(argv_size, sizeof(char*)) : NULL,
+                   calloc(argv_size, sizeof(char*)),
+                   build_title(program, arguments, files, file_count),
+                   NULL,
+                   0,
+                   NULL,
+                   0};
+  if (test.arguments == NULL || (reference && test.expected == NULL) ||
+      test.actual == NULL || test.title == NULL) {
+    free(test.arguments);
+    free(test.expected);
+    free(test.actual);
+    free(test.title);
+    return NULL;
+  }
+
+  size_t count = 0;
+  char* save = NULL;
+  test.actual[count++] = (char*)program;
+  for (char* word = strtok_r(test.arguments, " ", &save); word != NULL;
+       word = strtok_r(NULL, " ", &save)) {
+    test.actual[count++] = word;
+  }
+  for (size_t i = 0; i < file_count; i++) test.actual[count++] = files[i];
+  if (reference != NULL) {
+    memcpy(test.expected, test.actual, count * sizeof(char*));
+    test.expected[0] = (char*)reference;
+  }
+  suite->cases[suite->count] = test;
+  return &suite->cases[suite->count++];
+}
+
+/**
+ * Добавление проверки, сравнивающей вывод с эталонной утилитой
+ * @param suite Набор
+ * @param reference Эталонная утилита ("grep")
+ * @param program Своя программа ("./s21_grep")
+ * @param arguments Флаги и шаблоны через пробел
+ * @param files Входные файлы (строки должны жить дольше набора)
+ * @param file_count Количество файлов
+ * @return false при нехватке памяти
+ */
+bool add_test_case(TestSuite* suite, const char* reference,
+                   const char* program, const char* arguments,
+                   char* const* files, size_t file_count) {
+  return append_test_case(suite, reference, program, arguments, files,
+                          file_count) != NULL;
+}
+
+/**
+ * Добавление проверки с заранее известным результатом - для режимов,
+ * которых нет у эталонной утилиты. Кроме вывода сравнивается stderr:
+ * так проверяются сообщения об ошибках
+ * @param suite Набор
+ * @param program Своя программа ("./s21_grep")
+ * @param arguments Флаги и шаблоны через пробел
+ * @param files Входные файлы (строки должны жить дольше набора)
+ * @param file_count Количество файлов
+ * @param output Ожидаемый вывод (должен жить дольше набора)
+ * @param output_length Длина вывода, не больше TEST_FIXED_OUTPUT_MAX
+ * @param errors Ожидаемый stderr, не длиннее TEST_FIXED_OUTPUT_MAX
+ *               (должен жить дольше набора)
+ * @param code Ожидаемый код завершения
+ * @return false при нехватке памяти или слишком длинном выводе
+ */
+bool add_fixed_case(TestSuite* suite, const char* program,
+                    const char* arguments, char* const* files,
+                    size_t file_count, const char* output,
+                    size_t output_length, const char* errors, int code) {
+  if (output_length > TEST_FIXED_OUTPUT_MAX ||
+      strlen(errors) > TEST_FIXED_OUTPUT_MAX) {
+    return false;
+  }
+  TestCase* test =
+      append_test_case(suite, NULL, program, arguments, files, file_count);
+  if (test == NULL) return false;
+  test->output = output;
+  test->output_length = output_length;
+  test->errors = errors;
+  test->output_code = code;
+  return true;
+}
+
+/**
+ * Запуск команды с выводом в канал. stdin направляется в /dev/null,
+ * stderr - в errors_fd или в /dev/null; концы канала закрываются при
+ * exec, чтобы параллельно запущенные команды не держали чужие каналы
+ * открытыми
+ * @param argv Аргументы команды
+ * @param errors_fd Файл для stderr или -1
+ * @param stream Поток для заполнения дескриптора и процесса
+ * @return false если команду не удалось запустить
+ */
+static bool spawn_test_command(char** argv, int errors_fd,
+                               TestStream* stream) {
+  int pipe_fds[2];
+  if (pipe2(pipe_fds, O_CLOEXEC) != 0) return false;
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                   O_RDONLY, 0);
+  posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+  if (errors_fd >= 0) {
+    posix_spawn_file_actions_adddup2(&actions, errors_fd, STDERR_FILENO);
+  } else {
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                     O_WRONLY, 0);
+  }
+  int status =
+      posix_spawnp(&stream->pid, argv[0], &actions, NULL, argv, environ);
+  posix_spawn_file_actions_destroy(&actions);
+  close(pipe_fds[1]);
+
+  if (status != 0) {
+    close(pipe_fds[0]);
+    stream->pid = -1;
+    return false;
+  }
+  stream->fd = pipe_fds[0];
+  return true;
+}
+
+/**
+ * Канал с заранее известным выводом вместо эталонной команды. Вывод
+ * не длиннее TEST_FIXED_OUTPUT_MAX, поэтому запись не блокируется
+ * @param test Проверка с заданным выводом
+ * @param stream Поток для заполнения дескриптора
+ * @return false если канал не удалось создать
+ */
+static bool open_fixed_output(const TestCase* test, TestStream* stream) {
+  int pipe_fds[2];
+  if (pipe2(pipe_fds, O_CLOEXEC) != 0) return false;
+  ssize_t written = write(pipe_fds[1], test->output, test->output_length);
+  close(pipe_fds[1]);
+  if (written != (ssize_t)test->output_length) {
+    close(pipe_fds[0]);
+    return false;
+  }
+  stream->fd = pipe_fds[0];
+  return true;
+}
+
+/**
+ * Копирование участка вывода в строку с экранированием переводов
+ * строк, табуляций и непечатаемых байт
+ * @param excerpt Строка из TEST_EXCERPT_SIZE байт
+ * @param data Вывод
+ * @param length Длина участка
+ */
+static void copy_excerpt(char* excerpt, const char* data, size_t length) {
+  size_t pos = 0;
+  for (size_t i = 0; i < length && pos + 5 < TEST_EXCERPT_SIZE; i++) {
+    unsigned char c = (unsigned char)data[i];
+    if (c == '\n') {
+      pos += (size_t)sprintf(excerpt + pos, "\\n");
+    } else if (c == '\t') {
+      pos += (size_t)sprintf(excerpt + pos, "\\t");
+    } else if (c == '\\') {
+      pos += (size_t)sprintf(excerpt + pos, "\\\\");
+    } else if (c < ' ' || c >= 0x7f) {
+      pos += (size_t)sprintf(excerpt + pos, "\\x%02x", c);
+    } else {
+      excerpt[pos++] = (char)c;
+    }
+  }
+  excerpt[pos] = '\0';
+}
+
+/**
+ * Запись места первого расхождения: смещение, строка и по
+ * TEST_EXCERPT_CONTEXT байт вывода до и после него
+ * @param compare Состояние сравнения
+ * @param result Итог проверки
+ */
+static void record_mismatch(const TestCompare* compare, TestResult* result) {
+  const char* data = compare->streams[0].data;
+  size_t at = compare->checked;
+  size_t from = at > TEST_EXCERPT_CONTEXT ? at - TEST_EXCERPT_CONTEXT : 0;
+  const char* newline = memrchr(data + from, '\n', at - from);
+  if (newline != NULL) from = (size_t)(newline - data) + 1;
+
+  result->mismatch = true;
+  result->mismatch_at = compare->discarded + at;
+  result->mismatch_line = compare->line + count_newlines(data, at);
+  char* excerpts[2] = {result->expected_excerpt, result->actual_excerpt};
+  for (int i = 0; i < 2; i++) {
+    const TestStream* stream = &compare->streams[i];
+    size_t to = at + TEST_EXCERPT_CONTEXT;
+    if (to > stream->length) to = stream->length;
+    copy_excerpt(excerpts[i], stream->data + from, to - from);
+  }
+}
+
+/**
+ * Сравнение накопленного вывода. Совпавшие полные строки выбрасываются
+ * из окон; если окно заполнено одной строкой, выбрасывается все
+ * совпавшее
+ * @param compare Состояние сравнения
+ * @param result Итог проверки (заполняется при расхождении)
+ */
+static void compare_pending(TestCompare* compare, TestResult* result) {
+  TestStream* expected = &compare->streams[0];
+  TestStream* actual = &compare->streams[1];
+  size_t common =
+      expected->length < actual->length ? expected->length : actual->length;
+
+  if (memcmp(expected->data + compare->checked,
+             actual->data + compare->checked, common - compare->checked)) {
+    while (expected->data[compare->checked] ==
+           actual->data[compare->checked]) {
+      compare->checked++;
+    }
+    record_mismatch(compare, result);
+    return;
+  }
+  compare->checked = common;
+
+  bool expected_ended = expected->fd < 0 && expected->length == common;
+  bool actual_ended = actual->fd < 0 && actual->length == common;
+  if (expected_ended != actual_ended &&
+      expected->length + actual->length > 2 * common) {
+    record_mismatch(compare, result);
+    return;
+  }
+
+  const char* newline = memrchr(expected->data, '\n', compare->checked);
+  size_t drop = newline ? (size_t)(newline - expected->data) + 1 : 0;
+  if (drop == 0 && (expected->length == TEST_WINDOW_SIZE ||
+                    actual->length == TEST_WINDOW_SIZE)) {
+    drop = compare->checked;
+  }
+  if (drop == 0) return;
+
+  compare->line += count_newlines(expected->data, drop);
+  compare->discarded += drop;
+  compare->checked -= drop;
+  for (int i = 0; i < 2; i++) {
+    TestStream* stream = &compare->streams[i];
+    stream->length -= drop;
+    memmove(stream->data, stream->data + drop, stream->length);
+  }
+}
+
+/**
+ * Чтение доступной части вывода в окно. После найденного расхождения
+ * вывод только подсчитывается
+ * @param stream Поток
+ * @param discard Не сохранять прочитанное
+ */
+static void read_stream(TestStream* stream, bool discard) {
+  if (discard) stream->length = 0;
+  ssize_t result = read(stream->fd, stream->data + stream->length,
+                        TEST_WINDOW_SIZE - stream->length);
+  if (result < 0 && errno == EINTR) return;
+  if (result <= 0) {
+    close(stream->fd);
+    stream->fd = -1;
+    return;
+  }
+  stream->length += (size_t)result;
+  stream->total += (size_t)result;
+}
+
+/**
+ * Одновременное чтение и сравнение двух выводов. Поток, опередивший
+ * другой на целое окно, не читается, пока второй не догонит: команда
+ * ждет на записи в канал, и память не зависит от объема вывода
+ * @param compare Состояние сравнения с открытыми каналами
+ * @param result Итог проверки
+ */
+static void compare_streams(TestCompare* compare, TestResult* result) {
+  while (compare->streams[0].fd >= 0 || compare->streams[1].fd >= 0) {
+    struct pollfd fds[2];
+    TestStream* polled[2];
+    nfds_t count = 0;
+    for (int i = 0; i < 2; i++) {
+      TestStream* stream = &compare->streams[i];
+      if (stream->fd >= 0 &&
+          (result->mismatch || stream->length < TEST_WINDOW_SIZE)) {
+        fds[count] = (struct pollfd){stream->fd, POLLIN, 0};
+        polled[count++] = stream;
+      }
+    }
+    if (count == 0) break;
+    if (poll(fds, count, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+
+    for (nfds_t i = 0; i < count; i++) {
+      if (fds[i].revents != 0) read_stream(polled[i], result->mismatch);
+    }
+    if (!result->mismatch) compare_pending(compare, result);
+  }
+}
+
+/**
+ * Код завершения в стиле оболочки
+ * @param pid Процесс
+ * @return Код завершения, 128 + номер сигнала или -1
+ */
+static int wait_exit_code(pid_t pid) {
+  int status;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR) return -1;
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+/**
+ * Копирование сообщения из stderr в строку: UTF-8 остается как есть,
+ * экранируются только переводы строк, обрезка не разрывает символ
+ * @param excerpt Строка из TEST_EXCERPT_SIZE байт
+ * @param data Сообщение
+ * @param length Длина сообщения
+ */
+static void copy_message(char* excerpt, const char* data, size_t length) {
+  size_t pos = 0;
+  for (size_t i = 0; i < length && pos + 3 < TEST_EXCERPT_SIZE; i++) {
+    unsigned char c = (unsigned char)data[i];
+    if (c == '\n') {
+      pos += (size_t)sprintf(excerpt + pos, "\\n");
+    } else {
+      excerpt[pos++] = (char)c;
+    }
+  }
+  size_t lead = pos;
+  while (lead > 0 && ((unsigned char)excerpt[lead - 1] & 0xc0) == 0x80) {
+    lead--;
+  }
+  if (lead > 0 && (unsigned char)excerpt[lead - 1] >= 0xc0) {
+    unsigned char c = (unsigned char)excerpt[lead - 1];
+    size_t width = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : 2;
+    if (pos - (lead - 1) < width) pos = lead - 1;
+  }
+  excerpt[pos] = '\0';
+}
+
+/**
+ * Сравнение stderr завершившейся команды с ожидаемым
+ * @param test Проверка с заданным выводом
+ * @param errors_fd Файл, в который команда писала stderr
+ * @param result Итог (errors_mismatch и actual_errors)
+ */
+static void compare_errors(const TestCase* test, int errors_fd,
+                           TestResult* result) {
+  char errors[TEST_FIXED_OUTPUT_MAX + 1];
+  ssize_t length = pread(errors_fd, errors, sizeof(errors), 0);
+  if (length < 0) length = 0;
+  result->errors_mismatch =
+      (size_t)length != strlen(test->errors) ||
+      memcmp(errors, test->errors, (size_t)length) != 0;
+  copy_message(result->actual_errors, errors, (size_t)length);
+}
+
+/**
+ * Выполнение одной проверки: обе команды работают одновременно, их
+ * вывод сравнивается по мере поступления. У проверки с заданным выводом
+ * stderr пишется в анонимный файл и сравнивается после завершения
+ * @param test Проверка
+ * @param result Итог
+ * @param windows Два окна по TEST_WINDOW_SIZE байт
+ */
+static void run_test_case(const TestCase* test, TestResult* result,
+                          char* windows) {
+  TestCompare compare = {{{-1, -1, windows, 0, 0},
+                          {-1, -1, windows + TEST_WINDOW_SIZE, 0, 0}},
+                         0,
+                         0,
+                         1};
+  memset(result, 0, sizeof(TestResult));
+  int errors_fd =
+      test->expected == NULL ? memfd_create("stderr", MFD_CLOEXEC) : -1;
+  result->started =
+      (test->expected != NULL
+           ? spawn_test_command(test->expected, -1, &compare.streams[0])
+           : errors_fd >= 0 && open_fixed_output(test, &compare.streams[0])) &&
+      spawn_test_command(test->actual, errors_fd, &compare.streams[1]);
+  if (result->started) compare_streams(&compare, result);
+
+  for (int i = 0; i < 2; i++) {
+    TestStream* stream = &compare.streams[i];
+    if (stream->fd >= 0) close(stream->fd);
+  }
+  result->expected_code =
+      compare.streams[0].pid > 0 ? wait_exit_code(compare.streams[0].pid)
+                                 : test->output_code;
+  result->actual_code =
+      compare.streams[1].pid > 0 ? wait_exit_code(compare.streams[1].pid) : -1;
+  result->expected_bytes = compare.streams[0].total;
+  result->actual_bytes = compare.streams[1].total;
+  if (errors_fd >= 0) {
+    if (result->started) compare_errors(test, errors_fd, result);
+    close(errors_fd);
+  }
+}
+
+/**
+ * Рабочий поток: берет проверки по порядку, пока они не закончатся
+ * @param arg Общее состояние (TestRunner)
+ * @return NULL
+ */
+static void* test_worker(void* arg) {
+  TestRunner* runner = arg;
+  char* windows = malloc(2 * TEST_WINDOW_SIZE);
+  if (windows == NULL) return NULL;
+
+  size_t index;
+  while ((index = atomic_fetch_add(&runner->next, 1)) < runner->suite->count) {
+    run_test_case(&runner->suite->cases[index], &runner->results[index],
+                  windows);
+  }
+  free(windows);
+  return NULL;
+}
+
+/**
+ * Проверка пройдена: вывод совпал, а при compare_codes - и код
+ * завершения
+ * @param suite Набор
+ * @param result Итог
+ * @return true если проверка пройдена
+ */
+static bool test_passed(const TestSuite* suite, const TestResult* result) {
+  return result->started && !result->mismatch && !result->errors_mismatch &&
+         (!suite->compare_codes ||
+          result->expected_code == result->actual_code);
+}
+
+/**
+ * Вывод подробностей непройденной проверки
+ * @param test Проверка
+ * @param result Итог
+ */
+static void print_failure(const TestCase* test, const TestResult* result) {
+  printf("FAIL: %s\n", test->title);
+  if (!result->started) {
+    printf("  не удалось запустить команду\n\n");
+    return;
+  }
+  if (result->mismatch) {
+    printf("  первое расхождение: байт %zu, строка %zu\n", result->mismatch_at,
+           result->mismatch_line);
+    printf("  ожидалось: \"%s\"\n", result->expected_excerpt);
+    printf("  получено:  \"%s\"\n", result->actual_excerpt);
+  }
+  printf("  вывод: %zu байт, ожидалось %zu\n", result->actual_bytes,
+         result->expected_bytes);
+  if (result->errors_mismatch) {
+    char expected[TEST_EXCERPT_SIZE];
+    copy_message(expected, test->errors, strlen(test->errors));
+    printf("  stderr: \"%s\", ожидался \"%s\"\n", result->actual_errors,
+           expected);
+  }
+  printf("  код завершения: %d, ожидался %d\n\n", result->actual_code,
+         result->expected_code);
+}
+
+/**
+ * Выполнение всех проверок в suite->jobs потоков. Результаты выводятся
+ * в порядке добавления проверок, независимо от порядка выполнения
+ * @param suite Набор
+ * @return Количество непройденных проверок
+ */
+size_t run_test_suite(const TestSuite* suite) {
+  TestRunner runner = {suite, calloc(suite->count + 1, sizeof(TestResult)),
+                       0};
+  size_t jobs = (size_t)suite->jobs;
+  if (jobs > suite->count) jobs = suite->count > 0 ? suite->count : 1;
+  pthread_t* threads = calloc(jobs, sizeof(pthread_t));
+  if (runner.results == NULL || threads == NULL) {
+    free(runner.results);
+    free(threads);
+    fprintf(stderr, "Ошибка: Недостаточно памяти\n");
+    return suite->count;
+  }
+
+  struct timespec start, end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  size_t started = 0;
+  for (; started < jobs; started++) {
+    if (pthread_create(&threads[started], NULL, test_worker, &runner) != 0) {
+      break;
+    }
+  }
+  if (started == 0) test_worker(&runner);
+  for (size_t i = 0; i < started; i++) pthread_join(threads[i], NULL);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  size_t passed = 0;
+  for (size_t i = 0; i < suite->count; i++) {
+    if (suite->verbose) printf("Testing: %s\n", suite->cases[i].title);
+    if (test_passed(suite, &runner.results[i])) {
+      passed++;
+    } else {
+      print_failure(&suite->cases[i], &runner.results[i]);
+    }
+  }
+  double seconds = (double)(end.tv_sec - start.tv_sec) +
+                   (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+  printf("\nResults: %zu/%zu passed (%.1f%%)\n", passed, suite->count,
+         suite->count ? (float)passed / (float)suite->count * 100 : 100.0f);
+  printf("Time: %.2f s, %zu threads\n", seconds, started ? started : 1);
+
+  free(runner.results);
+  free(threads);
+  return suite->count - passed;
+}
+
+/**
+ * Освобождение набора
+ * @param suite Набор
+ */
+void free_test_suite(TestSuite* suite) {
+  for (size_t i = 0; i < suite->count; i++) {
+    free(suite->cases[i].arguments);
+    free(suite->cases[i].expected);
+    free(suite->cases[i].actual);
+    free(suite->cases[i].title);
+  }
+  free(suite->cases);
+  memset(suite, 0, sizeof(TestSuite));
+}
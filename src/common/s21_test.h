@@ -0,0 +1,65 @@
+#ifndef SRC_COMMON_S21_TEST_H_
+#define SRC_COMMON_S21_TEST_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TEST_WINDOW_SIZE (1 << 20)
+#define TEST_EXCERPT_CONTEXT 40
+#define TEST_EXCERPT_SIZE (4 * 2 * TEST_EXCERPT_CONTEXT + 1)
+#define TEST_TITLE_FILES 5
+#define TEST_FIXED_OUTPUT_MAX 4096  // Помещается в канал без ожидания
+
+/* Одна проверка: эталонная утилита и своя программа с одинаковыми
+ * аргументами или своя программа и заранее известный результат */
+typedef struct {
+  char* arguments;  // Копия строки аргументов, разбитая на слова
+  char** expected;  // Команда эталонной утилиты или NULL
+  char** actual;    // Команда своей программы
+  char* title;      // Команда своей программы одной строкой для вывода
+  const char* output;  // Ожидаемый вывод, если эталонной утилиты нет
+  size_t output_length;
+  const char* errors;  // Ожидаемый stderr (только без эталонной утилиты)
+  int output_code;     // Ожидаемый код завершения
+} TestCase;
+
+/* Итог проверки. Вывод сравнивается по мере поступления, поэтому в
+ * памяти хранится только место первого расхождения */
+typedef struct {
+  bool started;          // Обе команды удалось запустить
+  bool mismatch;         // Вывод различается
+  size_t mismatch_at;    // Смещение первого различающегося байта
+  size_t mismatch_line;  // Номер строки с этим байтом
+  size_t expected_bytes;
+  size_t actual_bytes;
+  int expected_code;
+  int actual_code;
+  char expected_excerpt[TEST_EXCERPT_SIZE];  // Вывод вокруг расхождения
+  char actual_excerpt[TEST_EXCERPT_SIZE];
+  bool errors_mismatch;                    // stderr отличается от errors
+  char actual_errors[TEST_EXCERPT_SIZE];  // Начало полученного stderr
+} TestResult;
+
+/* Набор проверок и параметры запуска */
+typedef struct {
+  TestCase* cases;
+  size_t count;
+  size_t capacity;
+  bool verbose;        // Аргумент "+": выводить все проверки
+  bool compare_codes;  // Сравнивать коды завершения, а не только вывод
+  int jobs;            // -j N: число параллельных проверок
+  size_t large_mb;     // --large N: проверки на наборах из N мегабайт
+} TestSuite;
+
+bool init_test_suite(TestSuite* suite, int argc, char** argv);
+bool add_test_case(TestSuite* suite, const char* reference,
+                   const char* program, const char* arguments,
+                   char* const* files, size_t file_count);
+bool add_fixed_case(TestSuite* suite, const char* program,
+                    const char* arguments, char* const* files,
+                    size_t file_count, const char* output,
+                    size_t output_length, const char* errors, int code);
+size_t run_test_suite(const TestSuite* suite);
+void free_test_suite(TestSuite* suite);
+
+#endif  // SRC_COMMON_S21_TEST_H_
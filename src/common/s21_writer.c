@@ -0,0 +1,108 @@
+#include "s21_writer.h"
+
+#include <errno.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "s21_stats.h"
+
+/* Пары десятичных цифр 00..99: число выводится по две цифры за деление */
+static const char kDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+/**
+ * Инициализация буфера вывода
+ * @param writer Буфер вывода
+ * @param fd Дескриптор, в который идет вывод
+ */
+void init_writer(OutputWriter* writer, int fd) {
+  writer->fd = fd;
+  writer->length = 0;
+  writer->failed = false;
+}
+
+/**
+ * Запись всех частей с повтором после частичной записи
+ * @param writer Буфер вывода
+ * @param parts Части (изменяются по ходу записи)
+ * @param count Количество частей
+ */
+static void write_all(OutputWriter* writer, struct iovec* parts, int count) {
+  while (count > 0 && !writer->failed) {
+    uint64_t started = stats_start();
+    ssize_t written = writev(writer->fd, parts, count);
+    stats_stop(TIMER_WRITE_WAIT, started);
+    stats_add(STAT_WRITE_CALLS, 1);
+    if (written < 0) {
+      if (errno != EINTR) writer->failed = true;
+      continue;
+    }
+
+    size_t rest = (size_t)written;
+    stats_add(STAT_BYTES_WRITTEN, rest);
+    while (count > 0 && rest >= parts->iov_len) {
+      rest -= parts->iov_len;
+      parts++;
+      count--;
+    }
+    if (count > 0) {
+      parts->iov_base = (char*)parts->iov_base + rest;
+      parts->iov_len -= rest;
+    }
+  }
+}
+
+/**
+ * Запись, не помещающаяся в буфер: содержимое буфера и новые данные
+ * уходят одним системным вызовом, сами данные не копируются
+ * @param writer Буфер вывода
+ * @param data Данные
+ * @param length Длина данных
+ */
+void writer_write_slow(OutputWriter* writer, const void* data, size_t length) {
+  struct iovec parts[2] = {{writer->data, writer->length},
+                           {(void*)data, length}};
+  write_all(writer, parts, 2);
+  writer->length = 0;
+}
+
+/**
+ * Запись десятичного числа, выровненного пробелами вправо
+ * @param writer Буфер вывода
+ * @param value Число
+ * @param width Минимальная ширина поля
+ */
+void writer_write_number(OutputWriter* writer, size_t value, size_t width) {
+  char digits[24];
+  size_t position = sizeof(digits);
+
+  while (value >= 100) {
+    position -= 2;
+    memcpy(digits + position, kDigitPairs + value % 100 * 2, 2);
+    value /= 100;
+  }
+  if (value >= 10) {
+    position -= 2;
+    memcpy(digits + position, kDigitPairs + value * 2, 2);
+  } else {
+    digits[--position] = (char)('0' + value);
+  }
+  while (sizeof(digits) - position < width && position > 0) {
+    digits[--position] = ' ';
+  }
+  writer_write(writer, digits + position, sizeof(digits) - position);
+}
+
+/**
+ * Сброс буфера в дескриптор
+ * @param writer Буфер вывода
+ * @return false если при выводе была ошибка
+ */
+bool writer_flush(OutputWriter* writer) {
+  struct iovec part = {writer->data, writer->length};
+  if (writer->length > 0) write_all(writer, &part, 1);
+  writer->length = 0;
+  return !writer->failed;
+}
@@ -0,0 +1,61 @@
+#ifndef SRC_COMMON_S21_WRITER_H_
+#define SRC_COMMON_S21_WRITER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define WRITER_BUFFER_SIZE 65536
+
+/* Буферизованный вывод в дескриптор. Мелкие записи копируются в буфер,
+ * крупная запись уходит одним writev вместе с содержимым буфера */
+typedef struct {
+  int fd;
+  size_t length;  // Количество байт в буфере
+  bool failed;    // Ошибка записи, дальнейший вывод отбрасывается
+  char data[WRITER_BUFFER_SIZE];
+} OutputWriter;
+
+void init_writer(OutputWriter* writer, int fd);
+void writer_write_slow(OutputWriter* writer, const void* data, size_t length);
+void writer_write_number(OutputWriter* writer, size_t value, size_t width);
+bool writer_flush(OutputWriter* writer);
+
+/**
+ * Запись данных. Быстрый путь встраивается в место вызова, поэтому
+ * запись одного символа не требует вызова функции
+ * @param writer Буфер вывода
+ * @param data Данные
+ * @param length Длина данных
+ */
+static inline void writer_write(OutputWriter* writer, const void* data,
+                                size_t length) {
+  if (length <= WRITER_BUFFER_SIZE - writer->length) {
+    memcpy(writer->data + writer->length, data, length);
+    writer->length += length;
+  } else {
+    writer_write_slow(writer, data, length);
+  }
+}
+
+/**
+ * Запись одного символа
+ * @param writer Буфер вывода
+ * @param character Символ
+ */
+static inline void writer_write_char(OutputWriter* writer, char character) {
+  if (writer->length == WRITER_BUFFER_SIZE) writer_flush(writer);
+  writer->data[writer->length++] = character;
+}
+
+/**
+ * Запись строки с завершающим нулем (сам ноль не выводится)
+ * @param writer Буфер вывода
+ * @param text Строка
+ */
+static inline void writer_write_string(OutputWriter* writer,
+                                       const char* text) {
+  writer_write(writer, text, strlen(text));
+}
+
+#endif  // SRC_COMMON_S21_WRITER_H_
@@ -0,0 +1,32 @@
+#include <stddef.h>
+
+#include "s21_bench.h"
+
+/* Шаблоны: FATAL встречается редко, INFO - в большинстве строк */
+static const BenchCase kCases[] = {
+    {"", "FATAL", CORPUS_HUGE},
+    {"", "INFO", CORPUS_HUGE},
+    {"-n", "ERROR", CORPUS_HUGE},
+    {"-c", "INFO", CORPUS_HUGE},
+    {"-c -v", "INFO", CORPUS_HUGE},
+    {"-i", "fatal", CORPUS_HUGE},
+    {"-o", "[0-9][0-9]*ms", CORPUS_HUGE},
+    {"-l", "FATAL", CORPUS_HUGE},
+    {"-c", "FATAL", CORPUS_SMALL_FILES},
+    {"-l", "ERROR", CORPUS_SMALL_FILES},
+    {"-n", "needle", CORPUS_LONG_LINES},
+    {"-c", "needle", CORPUS_LONG_LINES},
+    {"", "ERROR", CORPUS_BINARY},
+    {"-c", "ERROR", CORPUS_BINARY},
+};
+
+/**
+ * Замер производительности s21_grep рядом с GNU grep
+ * @param argc Количество аргументов командной строки
+ * @param argv [размер_МБ] [--no-syscalls]
+ * @return Код завершения
+ */
+int main(int argc, char **argv) {
+  return run_bench_suite("./s21_grep", "grep", kCases,
+                         sizeof(kCases) / sizeof(kCases[0]), argc, argv);
+}
@@ -1,7 +1,29 @@
 #include "s21_grep.h"
 
+_Thread_local ProgramOptions options;
+_Thread_local OutputWriter output;
+_Thread_local FILE* error_output;
+_Thread_local SearchStatus search_status;
+
+/* getopt хранит состояние разбора в глобальных переменных, поэтому
+ * запросы сервера разбирают аргументы по очереди */
+static pthread_mutex_t arguments_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const char kShortOptions[] = "e:f:ivclnhsowxzaIZ";
+static const struct option kLongOptions[] = {
+    {"index", required_argument, NULL, OPTION_INDEX},
+    {"build-index", required_argument, NULL, OPTION_BUILD_INDEX},
+    {"threads", required_argument, NULL, OPTION_THREADS},
+    {"stats", no_argument, NULL, OPTION_STATS},
+    {"serve", required_argument, NULL, OPTION_SERVE},
+    {"null", no_argument, NULL, 'Z'},
+    {"json", no_argument, NULL, OPTION_JSON},
+    {NULL, 0, NULL, 0}};
+
 /**
- * Точка входа в программу
+ * Точка входа в программу. Если задана переменная S21_GREP_SOCKET и
+ * сервер доступен, запрос выполняет сервер (--serve), иначе поиск идет
+ * в этом процессе
  * @param argc Количество аргументов командной строки
  * @param argv Массив аргументов командной строки
  * @return Код завершения программы
@@ -9,18 +31,74 @@
 int main(int argc, char** argv) {
   if (argc < 2) {
     fprintf(stderr,
-            "Использование: %s [-ivclnhso] ( [-e шаблон] [-f файл] || "
-            "[шаблон]) [файл ...]\n",
-            argv[0]);
-    return EXIT_FAILURE;
+            "Использование: %s [-ivclnhsowxzaIZ] [--json] [--threads N] "
+            "[--stats] [--index каталог] "
+            "( [-e шаблон] [-f файл] || [шаблон]) [файл ...]\n"
+            "       %s --build-index каталог\n"
+            "       %s --serve сокет [--threads N]\n"
+            "Сжатые файлы (gzip) распознаются только с флагом -z и "
+            "читаются в одном потоке, без --threads\n",
+            argv[0], argv[0], argv[0]);
+    return GREP_EXIT_ERROR;
   }
 
-  initialize_options();
+  const char* socket_path = getenv(SERVER_SOCKET_ENV);
+  if (socket_path != NULL && *socket_path != '\0') {
+    int code = forward_to_server(socket_path, argc, argv);
+    if (code >= 0) return code;
+  }
+
+  int code = run_grep(argc, argv, STDOUT_FILENO, stderr, false);
+  clear_matcher_cache();
+  return code;
+}
+
+/**
+ * Один запуск grep: разбор аргументов, поиск и вывод. Так выполняется
+ * и обычный запуск, и запрос к серверу
+ * @param argc Количество аргументов
+ * @param argv Аргументы
+ * @param output_fd Дескриптор для результатов
+ * @param errors Поток для сообщений об ошибках
+ * @param remote Запрос пришел серверу (--serve и --stats недоступны)
+ * @return Код завершения
+ */
+int run_grep(int argc, char** argv, int output_fd, FILE* errors,
+             bool remote) {
   char search_pattern[BUFFER_SIZE] = {0};
-  parse_arguments(argc, argv, search_pattern);
-  process_files(argc, argv, search_pattern);
+  initialize_options();
+  init_writer(&output, output_fd);
+  error_output = errors;
+  search_status = (SearchStatus){false, false};
+
+  pthread_mutex_lock(&arguments_lock);
+  bool parsed = parse_arguments(argc, argv, search_pattern);
+  pthread_mutex_unlock(&arguments_lock);
+  if (!parsed) return GREP_EXIT_ERROR;
+
+  if (remote &&
+      (options.serve_path != NULL || options.build_index_dir != NULL)) {
+    fprintf(error_output, "Ошибка: Флаг недоступен в запросе к серверу\n");
+    return GREP_EXIT_ERROR;
+  }
+  if (options.show_stats && !remote) enable_stats();
+  if (options.serve_path != NULL) return run_server(options.serve_path);
 
-  return EXIT_SUCCESS;
+  if (options.build_index_dir != NULL) {
+    return build_index(options.build_index_dir) == 0 ? GREP_EXIT_MATCH
+                                                     : GREP_EXIT_ERROR;
+  }
+
+  if (options.index_dir != NULL) {
+    process_indexed_directory(argc, search_pattern);
+  } else {
+    process_files(argc, argv, search_pattern);
+  }
+
+  bool written = writer_flush(&output);
+  if (!remote) print_stats("s21_grep");
+  if (!written || search_status.failed) return GREP_EXIT_ERROR;
+  return search_status.selected ? GREP_EXIT_MATCH : GREP_EXIT_NO_MATCH;
 }
 
 /* Инициализация опций программы значениями по умолчанию*/
@@ -35,7 +113,20 @@ void initialize_options(void) {
   options.no_errors_file = false;
   options.patterns_from_file = false;
   options.only_matching = false;
+  options.word_regexp = false;
+  options.line_regexp = false;
+  options.decompress = false;
+  options.text_mode = false;
+  options.skip_binary = false;
+  options.null_after_name = false;
+  options.json = false;
+  options.index_dir = NULL;
+  options.build_index_dir = NULL;
+  options.serve_path = NULL;
+  options.threads = default_thread_count();
+  options.show_stats = false;
   options.files_count = 0;
+  options.first_file = 0;
 }
 
 /**
@@ -43,22 +134,29 @@ void initialize_options(void) {
  * @param argc Количество аргументов
  * @param argv Массив аргументов
  * @param search_pattern Буфер для сохранения шаблона поиска
+ * @return false при некорректных аргументах (сообщение уже выведено)
  */
-void parse_arguments(int argc, char** argv, char* search_pattern) {
+bool parse_arguments(int argc, char** argv, char* search_pattern) {
   int option;
   int pattern_count = 0;
 
   opterr = 0;
+  optind = 0;  // Полный сброс getopt: аргументы разбираются повторно
 
-  while ((option = getopt_long(argc, argv, "e:f:ivclnhso", NULL, NULL)) != -1) {
+  while ((option = getopt_long(argc, argv, kShortOptions, kLongOptions,
+                               NULL)) != -1) {
     switch (option) {
       case 'e':
         options.use_extended_pattern = true;
-        handle_extended_pattern(&pattern_count, search_pattern);
+        if (!handle_extended_pattern(&pattern_count, search_pattern)) {
+          return false;
+        }
         break;
       case 'f':
         options.patterns_from_file = true;
-        handle_pattern_from_file(&pattern_count, search_pattern);
+        if (!handle_pattern_from_file(&pattern_count, search_pattern)) {
+          return false;
+        }
         break;
       case 'i':
         options.case_insensitive = true;
@@ -84,9 +182,50 @@ void parse_arguments(int argc, char** argv, char* search_pattern) {
       case 'o':
         options.only_matching = true;
         break;
+      case 'w':
+        options.word_regexp = true;
+        break;
+      case 'x':
+        options.line_regexp = true;
+        break;
+      case 'z':
+        options.decompress = true;
+        break;
+      case 'a':
+        options.text_mode = true;
+        break;
+      case 'I':
+        options.skip_binary = true;
+        break;
+      case 'Z':
+        options.null_after_name = true;
+        break;
+      case OPTION_JSON:
+        options.json = true;
+        break;
+      case OPTION_INDEX:
+        options.index_dir = optarg;
+        break;
+      case OPTION_BUILD_INDEX:
+        options.build_index_dir = optarg;
+        break;
+      case OPTION_THREADS:
+        options.threads = atoi(optarg);
+        if (options.threads < 1) options.threads = 1;
+        if (options.threads > PARALLEL_MAX_THREADS) {
+          options.threads = PARALLEL_MAX_THREADS;
+        }
+        break;
+      case OPTION_STATS:
+        options.show_stats = true;
+        break;
+      case OPTION_SERVE:
+        options.serve_path = optarg;
+        break;
       case '?':
-        fprintf(stderr, "Ошибка: Некорректный флаг -%c\n", (char)optopt);
-        exit(EXIT_FAILURE);
+        fprintf(error_output, "Ошибка: Некорректный флаг -%c\n",
+                (char)optopt);
+        return false;
       default:
         break;
     }
@@ -95,9 +234,55 @@ void parse_arguments(int argc, char** argv, char* search_pattern) {
   if (options.files_name_only == true)
     options.no_filename = false;  // Флаг -l подразумевает отсутствие -h
 
-  if (!options.use_extended_pattern && !options.patterns_from_file) {
-    handle_default_pattern(argv, search_pattern);
+  if (options.build_index_dir == NULL && options.serve_path == NULL &&
+      !options.use_extended_pattern && !options.patterns_from_file &&
+      !handle_default_pattern(argv, search_pattern)) {
+    return false;
+  }
+  options.first_file = optind;
+  return true;
+}
+
+/**
+ * Проверка, есть ли среди аргументов --serve или --build-index (такие
+ * запуски всегда выполняются локально). Аргументы разбираются той же
+ * таблицей getopt_long, что и в parse_arguments, поэтому значения -e и
+ * -f, аргументы после "--" и сокращения флагов понимаются одинаково.
+ * getopt переставляет аргументы, поэтому разбирается копия argv
+ * @param argc Количество аргументов
+ * @param argv Массив аргументов
+ * @return true если запуск нужно выполнить локально (и при нехватке
+ *         памяти)
+ */
+bool has_local_only_option(int argc, char** argv) {
+  char** copy = malloc((size_t)(argc + 1) * sizeof(char*));
+  if (copy == NULL) return true;
+  memcpy(copy, argv, (size_t)argc * sizeof(char*));
+  copy[argc] = NULL;
+
+  bool local = false;
+  int option;
+  pthread_mutex_lock(&arguments_lock);
+  opterr = 0;
+  optind = 0;
+  while ((option = getopt_long(argc, copy, kShortOptions, kLongOptions,
+                               NULL)) != -1) {
+    if (option == OPTION_SERVE || option == OPTION_BUILD_INDEX) local = true;
   }
+  pthread_mutex_unlock(&arguments_lock);
+  free(copy);
+  return local;
+}
+
+/**
+ * Часть строки, которая должна совпасть с шаблоном. Как и в GNU grep,
+ * -x важнее -w
+ * @return Область совпадения для init_matcher
+ */
+MatchScope match_scope(void) {
+  if (options.line_regexp) return SCOPE_LINE;
+  if (options.word_regexp) return SCOPE_WORD;
+  return SCOPE_ANY;
 }
 
 /**
@@ -108,233 +293,592 @@ void parse_arguments(int argc, char** argv, char* search_pattern) {
  */
 void process_files(int argc, char** argv, const char* search_pattern) {
   options.files_count =
-      argc -
-      optind;  // вычисление количества файлов, переданных в командной строке
+      argc - options.first_file;  // количество файлов в командной строке
+
+  for (int i = options.first_file; i < argc; i++) {
+    FILE* file = open_input_file(argv[i]);
+    if (file == NULL) continue;
 
-  for (; optind < argc; optind++) {
-    FILE* file = fopen(argv[optind], "r");
-    if (file == NULL) {
+    uint64_t started = stats_start();
+    search_in_file(argv[i], search_pattern, file);
+    stats_stop(TIMER_PROCESSING, started);
+    fclose(file);
+  }
+}
+
+/**
+ * Открытие входного файла. С флагом -z сжатые файлы распознаются по
+ * сигнатуре и читаются через поток распаковки
+ * @param path Путь к файлу
+ * @return Открытый файл или NULL (сообщение об ошибке уже выведено)
+ */
+FILE* open_input_file(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    print_path_error("Не удалось открыть файл", path);
+    return NULL;
+  }
+
+  CompressionFormat format =
+      options.decompress ? detect_compression(file) : COMPRESSION_NONE;
+  if (format != COMPRESSION_NONE) {
+    FILE* decompressed;
+    int error = open_decompressed(file, format, &decompressed);
+    if (error == ENOTSUP) {
+      search_status.failed = true;
       if (!options.no_errors_file) {
-        fprintf(stderr, "Ошибка: Не удалось открыть файл %s\n", argv[optind]);
+        fprintf(error_output,
+                "Ошибка: Формат %s не поддерживается (файл %s)\n",
+                compression_name(format), path);
       }
+    } else if (error != 0) {
+      search_status.failed = true;
+      if (!options.no_errors_file) {
+        fprintf(error_output, "Ошибка: Не удалось распаковать файл %s: %s\n",
+                path, strerror(error));
+      }
+    }
+    if (decompressed == NULL) fclose(file);
+    file = decompressed;
+  }
+  return file;
+}
+
+/**
+ * Сообщение об ошибке, связанной с файлом или каталогом. С флагом -s
+ * сообщение не выводится, но код завершения все равно будет 2
+ * @param message Текст ошибки
+ * @param path Путь к файлу или каталогу
+ */
+void print_path_error(const char* message, const char* path) {
+  search_status.failed = true;
+  if (!options.no_errors_file) {
+    fprintf(error_output, "Ошибка: %s %s\n", message, path);
+  }
+}
+
+/**
+ * Сообщение об ошибке чтения или распаковки файла
+ * @param path Путь к файлу
+ */
+void print_read_error(const char* path) {
+  print_path_error("Не удалось прочитать файл", path);
+}
+
+/**
+ * Сообщение о файле, который укоротили во время чтения: часть
+ * результата могла быть найдена в нулях вместо данных
+ * @param path Путь к файлу
+ */
+void print_truncated_error(const char* path) {
+  print_path_error("Во время чтения укорочен файл", path);
+}
+
+/**
+ * Сообщение о некорректном регулярном выражении
+ */
+void print_pattern_error(void) {
+  search_status.failed = true;
+  fprintf(error_output, "Ошибка: Некорректное регулярное выражение\n");
+}
+
+/**
+ * Поиск по файлам каталога с триграммным индексом (флаг --index).
+ * Файлы, которые по индексу не могут содержать совпадений, не читаются;
+ * файлы, отсутствующие в индексе или изменившиеся после его построения,
+ * просматриваются полностью
+ * @param argc Количество аргументов
+ * @param pattern Шаблон для поиска
+ */
+void process_indexed_directory(int argc, const char* pattern) {
+  if (options.first_file < argc) {
+    fprintf(error_output,
+            "Ошибка: С флагом --index файлы берутся из каталога\n");
+    search_status.failed = true;
+    return;
+  }
+
+  size_t count = 0;
+  char** names = list_index_directory(options.index_dir, &count);
+  if (names == NULL) {
+    print_path_error("Не удалось прочитать каталог", options.index_dir);
+    return;
+  }
+
+  TrigramIndex index;
+  bool has_index = open_index(&index, options.index_dir) == 0;
+  bool* candidates = NULL;
+  bool narrowed = false;
+  // Индекс строится по сырым байтам, поэтому со сжатыми файлами (-z) и
+  // инвертированным поиском он не сужает множество файлов
+  if (has_index && !options.invert_match && !options.decompress) {
+    candidates = malloc((index.header->file_count + 1) * sizeof(bool));
+    narrowed = candidates != NULL &&
+               collect_index_candidates(&index, pattern, candidates);
+  }
+
+  options.files_count = (int)count;
+  for (size_t i = 0; i < count; i++) {
+    char path[BUFFER_SIZE];
+    struct stat file_stat;
+    snprintf(path, sizeof(path), "%s/%s", options.index_dir, names[i]);
+
+    long entry = has_index ? find_index_entry(&index, names[i]) : -1;
+    if (narrowed && entry >= 0) stats_add(STAT_PREFILTER_CHECKS, 1);
+    if (narrowed && entry >= 0 && !candidates[entry] &&
+        stat(path, &file_stat) == 0 &&
+        index_entry_is_fresh(&index, (size_t)entry, &file_stat)) {
+      stats_add(STAT_PREFILTER_SKIPPED, 1);
+      print_file_summary(path, 0);
       continue;
     }
 
-    search_in_file(argv, search_pattern, file);
+    FILE* file = open_input_file(path);
+    if (file == NULL) continue;
+    uint64_t started = stats_start();
+    search_in_file(path, pattern, file);
+    stats_stop(TIMER_PROCESSING, started);
     fclose(file);
   }
+
+  free(candidates);
+  if (has_index) close_index(&index);
+  free_index_directory(names, count);
 }
 
 /**
  * Поиск шаблона в файле
- * @param argv Аргументы командной строки
+ * @param filename Имя файла для вывода
  * @param pattern Шаблон для поиска
  * @param file Файл для обработки
  */
-void search_in_file(char** argv, const char* pattern, FILE* file) {
-  regex_t regex;  // структура для регулярного выражения
-  char buffer[BUFFER_SIZE];
-  int line_number = 1;  // номер строки (отчет с первой)
-  int match_count = 0;  // количество совпадающих строк
-  regmatch_t match[1];
+void search_in_file(const char* filename, const char* pattern, FILE* file) {
+  Matcher* matcher;
+  BlockReader reader;
+  const char* block;
+  size_t length;
+  FileSearch search = {filename, 1, 0, false, false, NULL, NULL, 0};
+
+  stats_add(STAT_FILES, 1);
+  // Начало записей --json собирается заново для каждого файла
+  if (options.json) reset_json_prefix();
+  if (search_file_parallel(filename, pattern, file)) return;
+
+  if (options.count_only && !options.files_name_only) {
+    count_in_file(filename, pattern, file);
+    return;
+  }
 
-  if (regcomp(&regex, pattern, create_regex_flags(options.case_insensitive)) !=
-      0) {
-    fprintf(stderr, "Ошибка: Некорректное регулярное выражение\n");
+  matcher = acquire_matcher(pattern, options.case_insensitive, match_scope());
+  if (matcher == NULL) {
+    print_pattern_error();
+    return;
+  }
+  if (!init_block_reader(&reader, file, true)) {
+    release_matcher(matcher);
     return;
   }
 
-  while (fgets(buffer, BUFFER_SIZE, file) != NULL) {
-    int result = regexec(&regex, buffer, 1, match, 0);
+  bool first_block = true;
+  while (!search.stop && read_block(&reader, &block, &length)) {
+    // Двоичность определяется по первому блоку: в тексте нет нулевых байт
+    if (first_block && !options.text_mode) {
+      search.binary = is_binary_block(block, length);
+      search.stop = search.binary && options.skip_binary;
+    }
+    first_block = false;
+
+    const char* subject = matcher_subject(matcher, block, length);
+    if (subject == NULL) break;
+    search_block(&search, matcher, block, subject, length);
+  }
+
+  print_file_summary(filename, search.match_count);
+  stats_add(STAT_LINES_SCANNED, search.line_number - 1);
+  if (reader.truncated) {
+    print_truncated_error(filename);
+  } else if (reader.failed) {
+    print_read_error(filename);
+  }
+  free_block_reader(&reader);
+  release_matcher(matcher);
+}
 
-    if (options.invert_match) result = !result;
+/**
+ * Поиск в блоке целых строк. Шаблон ищется сразу по всему блоку, строки
+ * между совпадениями не просматриваются по отдельности (для -v именно
+ * они и выводятся)
+ * @param search Состояние поиска по файлу
+ * @param matcher Подготовленный шаблон
+ * @param block Блок строк
+ * @param subject Текст блока для сопоставления (см. matcher_subject)
+ * @param length Длина блока
+ */
+void search_block(FileSearch* search, const Matcher* matcher,
+                  const char* block, const char* subject, size_t length) {
+  size_t pos = 0;
+  search->block = block;
+
+  while (pos < length && !search->stop) {
+    regmatch_t match;
+    size_t hit_start = length;  // границы строки со следующим совпадением
+    size_t hit_end = length;
+    bool found = matcher_find(matcher, subject, pos, length, &match) &&
+                 !((size_t)match.rm_so == length && block[length - 1] == '\n');
+
+    if (found) {
+      size_t at = (size_t)match.rm_so;
+      const char* line_start = memrchr(block + pos, '\n', at - pos);
+      const char* line_end = memchr(block + at, '\n', length - at);
+      hit_start = line_start ? (size_t)(line_start - block) + 1 : pos;
+      hit_end = line_end ? (size_t)(line_end - block) : length;
+    }
 
-    if (result != REG_NOMATCH) {  // проверяет, было ли совпадение
-      if (!options.count_only && !options.files_name_only) {
-        print_matching_line(argv, buffer, result, match, &regex, line_number);
+    if (options.invert_match) {
+      LineIterator lines;
+      LineSpan line;
+      init_line_iterator(&lines, block + pos, hit_start - pos);
+      while (!search->stop && next_line(&lines, &line)) {
+        size_t offset = (size_t)(line.text - block);
+        select_line(search, matcher, line.text, subject + offset, line.length);
+        search->line_number++;
       }
-      match_count++;
+    } else if (found) {
+      search->line_number += count_newlines(block + pos, hit_start - pos);
+      select_line(search, matcher, block + hit_start, subject + hit_start,
+                  hit_end - hit_start);
+    } else {
+      search->line_number += count_lines(block + pos, length - pos);
+    }
+
+    if (found) {
+      search->line_number++;
+      pos = hit_end + 1;
+    } else {
+      pos = length;
     }
-    line_number++;
   }
+  search->block_offset += length;
+}
 
-  print_file_summary(argv, match_count);
-  regfree(&regex);
+/**
+ * Обработка строки, попавшей в результат (с учетом -v)
+ * @param search Состояние поиска по файлу
+ * @param matcher Подготовленный шаблон
+ * @param line Строка без '\n'
+ * @param subject Строка для сопоставления
+ * @param length Длина строки
+ */
+void select_line(FileSearch* search, const Matcher* matcher, const char* line,
+                 const char* subject, size_t length) {
+  search->match_count++;
+
+  if (options.files_name_only) {
+    search->stop = true;  // Для -l достаточно одной строки
+  } else if (search->binary && options.json) {
+    print_json_binary(search->filename);
+    search->stop = true;
+  } else if (search->binary) {
+    writer_write_string(&output, "Binary file ");
+    writer_write_string(&output, search->filename);
+    writer_write_string(&output, " matches\n");
+    search->stop = true;
+  } else {
+    print_matching_line(search, matcher, line, subject, length);
+  }
+}
+
+/**
+ * Подсчет строк с совпадением (флаг -c) без построчной обработки.
+ * Поиск идет по блокам целых строк; для -v из общего числа строк,
+ * посчитанного по символам '\n', вычитается число совпавших строк
+ * @param filename Имя файла для вывода
+ * @param pattern Шаблон для поиска
+ * @param file Файл для обработки
+ */
+void count_in_file(const char* filename, const char* pattern, FILE* file) {
+  Matcher* matcher;
+  BlockReader reader;
+  const char* block;
+  size_t length;
+  size_t total_lines = 0;     // все строки файла (для -v и --stats)
+  size_t matching_lines = 0;  // строки с совпадением
+  bool first_block = true;
+
+  matcher = acquire_matcher(pattern, options.case_insensitive, match_scope());
+  if (matcher == NULL) {
+    print_pattern_error();
+    return;
+  }
+  if (!init_block_reader(&reader, file, true)) {
+    release_matcher(matcher);
+    return;
+  }
+
+  while (read_block(&reader, &block, &length)) {
+    // Двоичный файл с флагом -I считается не содержащим совпадений
+    if (first_block && options.skip_binary && !options.text_mode &&
+        is_binary_block(block, length)) {
+      break;
+    }
+    first_block = false;
+
+    const char* subject = matcher_subject(matcher, block, length);
+    if (subject == NULL) break;
+    matching_lines += count_matching_lines(matcher, subject, length);
+    if (options.invert_match || stats_enabled) {
+      total_lines += count_lines(block, length);
+    }
+  }
+
+  print_file_summary(filename, options.invert_match
+                                   ? total_lines - matching_lines
+                                   : matching_lines);
+  stats_add(STAT_LINES_SCANNED, total_lines);
+  if (reader.truncated) {
+    print_truncated_error(filename);
+  } else if (reader.failed) {
+    print_read_error(filename);
+  }
+  free_block_reader(&reader);
+  release_matcher(matcher);
 }
 
 /**
  * Вывод строки с совпадением согласно флагам
- * @param argv Аргументы командной строки
- * @param line Строка с совпадением
- * @param match_result Результат сопоставления
- * @param match Информация о совпадении
- * @param regex Скомпилированное регулярное выражение
- * @param line_number Номер строки
+ * @param search Состояние поиска по файлу
+ * @param matcher Подготовленный шаблон
+ * @param line Строка с совпадением (без '\n')
+ * @param subject Строка, с которой сравнивается шаблон (для -i может быть
+ *        в нижнем регистре, смещения совпадают с line)
+ * @param length Длина строки
  */
-void print_matching_line(char** argv, const char* line, int match_result,
-                         regmatch_t match[], regex_t* regex, int line_number) {
-  if (options.only_matching && !options.invert_match) {
-    print_matches_only(line, match_result, match, regex, argv, line_number);
+void print_matching_line(FileSearch* search, const Matcher* matcher,
+                         const char* line, const char* subject,
+                         size_t length) {
+  if (options.json) {
+    emit_json_line(search, matcher, line, subject, length);
+
+  } else if (options.only_matching && !options.invert_match) {
+    print_matches_only(search, matcher, line, subject, length);
 
   } else if (!options.only_matching) {
-    print_line_header(argv, line_number);
-    printf("%s", line);
-    ensure_proper_newline(line);
+    emit_line_part(search, line, length);
   }
 }
 
 /**
  * Вывод только совпадающих частей строки (для флага -o)
+ * @param search Состояние поиска по файлу
+ * @param matcher Подготовленный шаблон
  * @param line Обрабатываемая строка
- * @param match_result Результат сопоставления
- * @param match Информация о совпадении
- * @param regex Скомпилированное регулярное выражение
- * @param argv Аргументы командной строки
- * @param line_number Номер строки
+ * @param subject Строка для сопоставления (той же длины, что и line)
+ * @param length Длина строки
  */
-void print_matches_only(const char* line, int match_result, regmatch_t match[],
-                        regex_t* regex, char** argv, int line_number) {
-  const char* ptr = line;
-
-  while (!match_result) {
-    if (match[0].rm_eo == match[0].rm_so) {
-      break;  // если совпадение не найдено
+void print_matches_only(FileSearch* search, const Matcher* matcher,
+                        const char* line, const char* subject, size_t length) {
+  size_t pos = 0;
+  regmatch_t match;
+
+  while (pos <= length && matcher_find(matcher, subject, pos, length, &match)) {
+    if (match.rm_eo == match.rm_so) {
+      // Пустое совпадение не выводится, поиск продолжается со следующего
+      // байта: для x* в "abxx" найдется "xx"
+      pos = (size_t)match.rm_so + 1;
+      continue;
     }
 
-    print_line_header(argv, line_number);
+    /* Смещения совпадения одинаковы для line и subject, поэтому
+     подстрока берется из исходной строки (регистр сохраняется) */
+    emit_line_part(search, line + match.rm_so,
+                   (size_t)(match.rm_eo - match.rm_so));
 
-    /*Код выводит подстроку заданной длины, начинающуюся с определенной позиции
-     первый аргумент printf() "%.*s\n" указывает на то, что будет выведена
-     строка, длина которой будет следующим аргументом (т.е. * означает, что
-     длина строки будет определена аргументом) (int)(match[0].rm_eo -
-     match[0].rm_so) вычисляет длину подстроки, извлеченной из исходной строки
-     ptr match[0].rm_eo и match[0].rm_so указывают на конец и начало найденного
-     соответствия регулярного выражения ptr + match[0].rm_so указывает на начало
-     подстроки */
+    pos = (size_t)match.rm_eo;
+  }
+}
+
+/**
+ * Вывод строки или ее части с заголовком. При параллельном поиске
+ * (search->matches != NULL) часть только запоминается: номер строки
+ * станет известен после подсчета строк в предыдущих кусках файла
+ * @param search Состояние поиска по файлу
+ * @param text Выводимый текст
+ * @param length Длина текста
+ */
+void emit_line_part(FileSearch* search, const char* text, size_t length) {
+  if (search->matches != NULL) {
+    append_match(search->matches, text, length, search->line_number,
+                 search->block_offset + (size_t)(text - search->block));
+    return;
+  }
+
+  print_line(search->filename, search->line_number, text, length);
+}
+
+/**
+ * Вывод записи JSON о строке (флаг --json; -o не действует, совпадения
+ * перечисляются в submatches). При параллельном поиске строка
+ * запоминается, границы совпадений ищутся при выводе
+ * @param search Состояние поиска по файлу
+ * @param matcher Подготовленный шаблон
+ * @param line Строка без '\n' (внутри search->block)
+ * @param subject Строка для сопоставления
+ * @param length Длина строки
+ */
+void emit_json_line(FileSearch* search, const Matcher* matcher,
+                    const char* line, const char* subject, size_t length) {
+  size_t offset = search->block_offset + (size_t)(line - search->block);
+  if (search->matches != NULL) {
+    append_match(search->matches, line, length, search->line_number, offset);
+    return;
+  }
 
-    printf("%.*s\n", (int)(match[0].rm_eo - match[0].rm_so),
-           ptr + match[0].rm_so);
+  print_json_match(search->filename, search->line_number, offset,
+                   options.invert_match ? NULL : matcher, line, subject,
+                   length);
+}
 
-    ptr += match[0].rm_eo;
-    match_result = regexec(regex, ptr, 1, match, REG_NOTBOL);
+/**
+ * Добавление найденной части строки в список
+ * @param list Список совпадений
+ * @param text Текст (указывает в отображенный файл)
+ * @param length Длина текста
+ * @param line_number Номер строки внутри куска файла
+ * @param offset Смещение строки в файле
+ */
+void append_match(MatchList* list, const char* text, size_t length,
+                  size_t line_number, size_t offset) {
+  if (list->count == list->capacity) {
+    size_t capacity = list->capacity ? list->capacity * 2 : 256;
+    MatchRecord* grown = realloc(list->items, capacity * sizeof(MatchRecord));
+    if (grown == NULL) {
+      list->failed = true;
+      return;
+    }
+    list->items = grown;
+    list->capacity = capacity;
   }
+  list->items[list->count++] =
+      (MatchRecord){text, length, line_number, offset};
+}
+
+/**
+ * Вывод строки или ее части с заголовком. Текст выводится по длине,
+ * поэтому нулевые байты (флаг -a) не обрывают строку
+ * @param filename Имя файла
+ * @param line_number Номер строки
+ * @param text Текст без '\n'
+ * @param length Длина текста
+ */
+void print_line(const char* filename, size_t line_number, const char* text,
+                size_t length) {
+  print_line_header(filename, line_number);
+  writer_write(&output, text, length);
+  writer_write_char(&output, '\n');
 }
 
 /**
  * Вывод заголовка строки (имя файла и номер строки)
- * @param argv Аргументы командной строки
+ * @param filename Имя файла
  * @param line_number Номер строки
  */
-void print_line_header(char** argv, int line_number) {
+void print_line_header(const char* filename, size_t line_number) {
   if (options.files_count > 1 && !options.no_filename) {
-    printf("%s:", argv[optind]);
+    writer_write_string(&output, filename);
+    writer_write_char(&output, options.null_after_name ? '\0' : ':');
   }
 
   if (options.line_numbers) {
-    printf("%d:", line_number);
+    writer_write_number(&output, line_number, 0);
+    writer_write_char(&output, ':');
   }
 }
 
 /**
  * Вывод сводной информации по файлу (для флагов -c и -l)
- * @param argv Аргументы командной строки
+ * @param filename Имя файла
  * @param match_count Количество совпадений
  */
-void print_file_summary(char** argv, int match_count) {
+void print_file_summary(const char* filename, size_t match_count) {
+  if (match_count > 0) search_status.selected = true;
+  if (options.json) {
+    print_json_summary(filename, match_count);
+    return;
+  }
+
   if (options.count_only) {
     if (options.no_filename) {
-      printf("%d\n", match_count);
+      writer_write_number(&output, match_count, 0);
+      writer_write_char(&output, '\n');
     } else if (!options.files_name_only) {
       if (options.files_count > 1) {
-        printf("%s:%d\n", argv[optind], match_count);
-      } else {
-        printf("%d\n", match_count);
+        writer_write_string(&output, filename);
+        writer_write_char(&output, options.null_after_name ? '\0' : ':');
       }
+      writer_write_number(&output, match_count, 0);
+      writer_write_char(&output, '\n');
     }
   }
 
   if (options.files_name_only && match_count > 0) {
-    printf("%s\n", argv[optind]);
-  }
-}
-
-/**
- * Проверка и добавление перевода строки при необходимости
- * @param line Проверяемая строка
- */
-void ensure_proper_newline(const char* line) {
-  if (get_last_character(line) != '\n') {
-    printf("\n");
-  }
-}
-
-/**
- * Создание флагов для регулярного выражения
- * @param ignore_case Флаг игнорирования регистра
- * @return Флаги для компиляции регулярного выражения
- */
-int create_regex_flags(bool ignore_case) {
-  int flags = REG_EXTENDED;
-  if (ignore_case) {
-    flags |= REG_ICASE;
+    writer_write_string(&output, filename);
+    writer_write_char(&output, options.null_after_name ? '\0' : '\n');
   }
-  return flags;
 }
 
 /**
  * Обработка шаблона из аргумента -e
  * @param pattern_count Счетчик шаблонов
  * @param search_string Буфер для сохранения шаблона
+ * @return false если шаблон не помещается в буфер
  */
-void handle_extended_pattern(int* pattern_count, char* search_string) {
+bool handle_extended_pattern(int* pattern_count, char* search_string) {
   if (optarg == NULL || *optarg == '\0') {
     optarg = ".";
   }
 
-  add_pattern_separator(pattern_count, search_string);
-  strcat(search_string, optarg);
-  (*pattern_count)++;
+  return append_pattern(pattern_count, search_string, optarg);
 }
 
 /**
  * Обработка шаблонов из файла (флаг -f)
  * @param pattern_count Счетчик шаблонов
  * @param search_string Буфер для сохранения шаблонов
+ * @return false если файл не удалось открыть или шаблоны не помещаются
+ *         в буфер
  */
-void handle_pattern_from_file(int* pattern_count, char* search_string) {
+bool handle_pattern_from_file(int* pattern_count, char* search_string) {
   FILE* pattern_file = fopen(optarg, "r");
   if (pattern_file == NULL) {
-    fprintf(stderr, "Ошибка: Не удалось открыть файл с шаблонами %s\n", optarg);
-    exit(EXIT_FAILURE);
+    fprintf(error_output, "Ошибка: Не удалось открыть файл с шаблонами %s\n",
+            optarg);
+    return false;
   }
 
   char buffer[BUFFER_SIZE];
-  while (fgets(buffer, BUFFER_SIZE, pattern_file) != NULL) {
+  bool ok = true;
+  while (ok && fgets(buffer, BUFFER_SIZE, pattern_file) != NULL) {
     remove_trailing_newline(buffer);
-
-    add_pattern_separator(pattern_count, search_string);
-    if (*buffer == '\0') {
-      strcat(search_string, ".");
-    } else {
-      strcat(search_string, buffer);
-    }
-    (*pattern_count)++;
+    ok = append_pattern(pattern_count, search_string,
+                        *buffer == '\0' ? "." : buffer);
   }
 
   fclose(pattern_file);
+  return ok;
 }
 
 /**
  * Обработка шаблона по умолчанию (без флагов -e/-f)
  * @param argv Аргументы командной строки
  * @param search_string Буфер для сохранения шаблона
+ * @return false если шаблон не помещается в буфер
  */
-void handle_default_pattern(char** argv, char* search_string) {
+bool handle_default_pattern(char** argv, char* search_string) {
+  int pattern_count = 0;
   if (argv[optind] == NULL) {
     argv[optind] = ".";
   }
-  strcpy(search_string, argv[optind]);
-  optind++;
+  return append_pattern(&pattern_count, search_string, argv[optind++]);
 }
 
 /**
@@ -358,12 +902,23 @@ char get_last_character(const char* line) {
 }
 
 /**
- * Добавление разделителя шаблонов (|) при необходимости
+ * Добавление шаблона через разделитель (|) с проверкой размера буфера
  * @param pattern_count Счетчик шаблонов
- * @param pattern Буфер с шаблонами
+ * @param pattern Буфер с шаблонами (BUFFER_SIZE байт)
+ * @param part Добавляемый шаблон
+ * @return false если шаблон не помещается в буфер
  */
-void add_pattern_separator(int* pattern_count, char* pattern) {
-  if (*pattern_count > 0) {
-    strcat(pattern, "|");
+bool append_pattern(int* pattern_count, char* pattern, const char* part) {
+  size_t used = strlen(pattern);
+  size_t separator = *pattern_count > 0 ? 1 : 0;
+  size_t length = strlen(part);
+  if (used + separator + length >= BUFFER_SIZE) {
+    fprintf(error_output, "Ошибка: Слишком длинный шаблон\n");
+    return false;
   }
+
+  if (separator) pattern[used++] = '|';
+  memcpy(pattern + used, part, length + 1);
+  (*pattern_count)++;
+  return true;
 }
\ No newline at end of file
@@ -1,15 +1,49 @@
 #ifndef SRC_GREP_S21_GREP_H_
 #define SRC_GREP_S21_GREP_H_
 
+#include <errno.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <regex.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "s21_grep_block.h"
+#include "s21_grep_cache.h"
+#include "s21_grep_casefold.h"
+#include "s21_grep_decompress.h"
+#include "s21_grep_index.h"
+#include "s21_grep_json.h"
+#include "s21_grep_matcher.h"
+#include "s21_grep_parallel.h"
+#include "s21_grep_server.h"
+#include "s21_reader.h"
+#include "s21_stats.h"
+#include "s21_writer.h"
 
 #define BUFFER_SIZE 4096
 
+/* Коды длинных опций без короткого аналога */
+enum {
+  OPTION_INDEX = 256,
+  OPTION_BUILD_INDEX,
+  OPTION_THREADS,
+  OPTION_STATS,
+  OPTION_SERVE,
+  OPTION_JSON
+};
+
+/* Коды завершения, как у GNU grep */
+enum {
+  GREP_EXIT_MATCH = 0,     // Найдена хотя бы одна строка
+  GREP_EXIT_NO_MATCH = 1,  // Строк не найдено
+  GREP_EXIT_ERROR = 2      // Ошибка (даже если что-то найдено)
+};
+
 /* Структура для хранения опций программы */
 typedef struct {
   bool use_extended_pattern;  // Флаг -e
@@ -22,29 +56,102 @@ typedef struct {
   bool no_errors_file;        // Флаг -s
   bool patterns_from_file;    // Флаг -f
   bool only_matching;         // Флаг -o
+  bool word_regexp;           // Флаг -w
+  bool line_regexp;           // Флаг -x
+  bool decompress;            // Флаг -z
+  bool text_mode;             // Флаг -a
+  bool skip_binary;           // Флаг -I
+  bool null_after_name;       // Флаг -Z (--null)
+  bool json;                  // Флаг --json
+  const char* index_dir;        // Флаг --index
+  const char* build_index_dir;  // Флаг --build-index
+  const char* serve_path;       // Флаг --serve (путь к сокету сервера)
+  int threads;  // Флаг --threads (потоки для поиска в большом файле)
+  bool show_stats;  // Флаг --stats
   int files_count;  // Количество файлов для обработки
+  int first_file;   // Индекс первого файла в argv
 } ProgramOptions;
 
-ProgramOptions options;
+/* Итог запуска, по которому выбирается код завершения */
+typedef struct {
+  bool selected;  // Хотя бы в одном файле есть строки в результате
+  bool failed;    // Была ошибка: файл, шаблон, аргументы
+} SearchStatus;
+
+/* Найденная строка или ее часть (для -o), ожидающая вывода */
+typedef struct {
+  const char* text;
+  size_t length;
+  size_t line_number;  // Номер строки внутри куска файла
+  size_t offset;       // Смещение строки в файле (для --json)
+} MatchRecord;
+
+/* Список найденных строк одного куска файла */
+typedef struct {
+  MatchRecord* items;
+  size_t count;
+  size_t capacity;
+  bool failed;  // Не хватило памяти
+} MatchList;
+
+/* Состояние поиска по одному файлу */
+typedef struct {
+  const char* filename;
+  size_t line_number;  // Номер текущей строки
+  size_t match_count;  // Количество строк в результате
+  bool binary;         // Файл распознан как двоичный
+  bool stop;           // Дальнейшее чтение файла не нужно
+  MatchList* matches;  // Куда складывать результат вместо вывода
+  const char* block;   // Текущий блок
+  size_t block_offset;  // Смещение текущего блока в файле
+} FileSearch;
+
+/* Состояние одного запуска. В режиме сервера каждый поток выполняет
+ * свой запрос, поэтому переменные у каждого потока свои */
+extern _Thread_local ProgramOptions options;
+extern _Thread_local OutputWriter output;
+extern _Thread_local FILE* error_output;
+extern _Thread_local SearchStatus search_status;
 
+int run_grep(int argc, char** argv, int output_fd, FILE* errors,
+             bool remote);
 void initialize_options(void);
-void parse_arguments(int argc, char** argv, char* search_pattern);
+bool parse_arguments(int argc, char** argv, char* search_pattern);
+bool has_local_only_option(int argc, char** argv);
+MatchScope match_scope(void);
 void process_files(int argc, char** argv, const char* pattern);
-void search_in_file(char** argv, const char* pattern, FILE* file);
-void print_matching_line(char** argv, const char* line, int match_result,
-                         regmatch_t match[], regex_t* regex, int line_number);
-void print_matches_only(const char* line, int match_result, regmatch_t match[],
-                        regex_t* regex, char** argv, int line_number);
-void print_line_header(char** argv, int line_number);
-void print_file_summary(char** argv, int match_count);
-
-void ensure_proper_newline(const char* line);
-int create_regex_flags(bool ignore_case);
-void handle_extended_pattern(int* pattern_count, char* search_string);
-void handle_pattern_from_file(int* pattern_count, char* search_string);
-void handle_default_pattern(char** argv, char* search_string);
+void process_indexed_directory(int argc, const char* pattern);
+FILE* open_input_file(const char* path);
+void print_path_error(const char* message, const char* path);
+void print_read_error(const char* path);
+void print_truncated_error(const char* path);
+void print_pattern_error(void);
+void search_in_file(const char* filename, const char* pattern, FILE* file);
+void search_block(FileSearch* search, const Matcher* matcher,
+                  const char* block, const char* subject, size_t length);
+void select_line(FileSearch* search, const Matcher* matcher, const char* line,
+                 const char* subject, size_t length);
+void count_in_file(const char* filename, const char* pattern, FILE* file);
+void print_matching_line(FileSearch* search, const Matcher* matcher,
+                         const char* line, const char* subject,
+                         size_t length);
+void print_matches_only(FileSearch* search, const Matcher* matcher,
+                        const char* line, const char* subject, size_t length);
+void emit_line_part(FileSearch* search, const char* text, size_t length);
+void emit_json_line(FileSearch* search, const Matcher* matcher,
+                    const char* line, const char* subject, size_t length);
+void append_match(MatchList* list, const char* text, size_t length,
+                  size_t line_number, size_t offset);
+void print_line(const char* filename, size_t line_number, const char* text,
+                size_t length);
+void print_line_header(const char* filename, size_t line_number);
+void print_file_summary(const char* filename, size_t match_count);
+
+bool handle_extended_pattern(int* pattern_count, char* search_string);
+bool handle_pattern_from_file(int* pattern_count, char* search_string);
+bool handle_default_pattern(char** argv, char* search_string);
 void remove_trailing_newline(char* line);
 char get_last_character(const char* line);
-void add_pattern_separator(int* pattern_count, char* pattern);
+bool append_pattern(int* pattern_count, char* pattern, const char* part);
 
 #endif  // SRC_GREP_S21_GREP_H_
@@ -0,0 +1,15 @@
+#include "s21_grep_block.h"
+
+#include <string.h>
+
+/**
+ * Проверка блока на двоичные данные: как и GNU grep в локали C, файл
+ * считается двоичным, если в нем есть нулевой байт (memchr просматривает
+ * текст со скоростью чтения памяти)
+ * @param data Данные
+ * @param length Длина данных
+ * @return true если данные двоичные
+ */
+bool is_binary_block(const char* data, size_t length) {
+  return memchr(data, '\0', length) != NULL;
+}
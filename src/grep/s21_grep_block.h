@@ -0,0 +1,10 @@
+#ifndef SRC_GREP_S21_GREP_BLOCK_H_
+#define SRC_GREP_S21_GREP_BLOCK_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Проверки над блоком строк, полученным из BlockReader (s21_reader.h) */
+bool is_binary_block(const char* data, size_t length);
+
+#endif  // SRC_GREP_S21_GREP_BLOCK_H_
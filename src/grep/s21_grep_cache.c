@@ -0,0 +1,134 @@
+#include "s21_grep_cache.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "s21_stats.h"
+
+/* Скомпилированный шаблон вместе с ключом кэша. Matcher - первое поле,
+ * поэтому указатель на него совпадает с указателем на запись */
+typedef struct {
+  Matcher matcher;
+  char* pattern;
+  bool ignore_case;
+  MatchScope scope;
+  bool busy;           // Шаблон сейчас используется одним из потоков
+  uint64_t last_used;  // Время последнего возврата в кэш (для LRU)
+} CachedMatcher;
+
+/* Кэш скомпилированных шаблонов. Один Matcher нельзя использовать из
+ * двух потоков сразу (regexec в glibc блокирует выражение, буфер -i
+ * общий), поэтому шаблон выдается потоку целиком и возвращается после
+ * поиска; если одинаковый шаблон уже занят, компилируется еще один */
+static CachedMatcher* cache[PATTERN_CACHE_SIZE];
+static uint64_t cache_clock;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Освобождение записи кэша
+ * @param entry Запись или NULL
+ */
+static void destroy_entry(CachedMatcher* entry) {
+  if (entry == NULL) return;
+  free_matcher(&entry->matcher);
+  free(entry->pattern);
+  free(entry);
+}
+
+/**
+ * Получение подготовленного шаблона: свободный шаблон с тем же ключом
+ * берется из кэша, иначе компилируется новый
+ * @param pattern Шаблон
+ * @param ignore_case Флаг -i
+ * @param scope Часть строки, которая должна совпасть (-w, -x)
+ * @return Шаблон для release_matcher или NULL, если выражение
+ *         некорректно или не хватило памяти
+ */
+Matcher* acquire_matcher(const char* pattern, bool ignore_case,
+                         MatchScope scope) {
+  pthread_mutex_lock(&cache_lock);
+  for (int i = 0; i < PATTERN_CACHE_SIZE; i++) {
+    CachedMatcher* entry = cache[i];
+    if (entry != NULL && !entry->busy && entry->ignore_case == ignore_case &&
+        entry->scope == scope && strcmp(entry->pattern, pattern) == 0) {
+      entry->busy = true;
+      pthread_mutex_unlock(&cache_lock);
+      stats_add(STAT_PATTERN_CACHE_HITS, 1);
+      return &entry->matcher;
+    }
+  }
+  pthread_mutex_unlock(&cache_lock);
+
+  CachedMatcher* entry = calloc(1, sizeof(CachedMatcher));
+  if (entry == NULL) return NULL;
+  entry->pattern = strdup(pattern);
+  if (entry->pattern == NULL ||
+      init_matcher(&entry->matcher, pattern, ignore_case, scope) != 0) {
+    destroy_entry(entry);
+    return NULL;
+  }
+  entry->ignore_case = ignore_case;
+  entry->scope = scope;
+  entry->busy = true;
+  return &entry->matcher;
+}
+
+/**
+ * Возврат шаблона в кэш. Новый шаблон занимает свободное место или
+ * вытесняет давно не использованный свободный; если все места заняты
+ * работающими потоками, он освобождается. Буфер для -i остается с
+ * шаблоном, чтобы поиск по многим файлам не выделял его заново, но не
+ * больше PATTERN_CACHE_SUBJECT_MAX: блок большого файла (до
+ * READ_BLOCK_SIZE и длиннее) не держится в кэше
+ * @param matcher Шаблон из acquire_matcher
+ */
+void release_matcher(Matcher* matcher) {
+  CachedMatcher* entry = (CachedMatcher*)matcher;
+  CachedMatcher* evicted = NULL;
+  bool cached = false;
+  int free_slot = -1;
+  int oldest = -1;  // Давно не использованный свободный шаблон
+
+  shrink_matcher_subject(matcher, PATTERN_CACHE_SUBJECT_MAX);
+  pthread_mutex_lock(&cache_lock);
+  entry->busy = false;
+  entry->last_used = ++cache_clock;
+  for (int i = 0; i < PATTERN_CACHE_SIZE; i++) {
+    if (cache[i] == entry) {
+      cached = true;
+    } else if (cache[i] == NULL) {
+      if (free_slot < 0) free_slot = i;
+    } else if (!cache[i]->busy &&
+               (oldest < 0 || cache[i]->last_used < cache[oldest]->last_used)) {
+      oldest = i;
+    }
+  }
+  if (!cached) {
+    int slot = free_slot >= 0 ? free_slot : oldest;
+    if (slot >= 0) {
+      evicted = cache[slot];
+      cache[slot] = entry;
+    } else {
+      evicted = entry;
+    }
+  }
+  pthread_mutex_unlock(&cache_lock);
+
+  destroy_entry(evicted);
+}
+
+/**
+ * Освобождение всех свободных шаблонов кэша (при завершении)
+ */
+void clear_matcher_cache(void) {
+  pthread_mutex_lock(&cache_lock);
+  for (int i = 0; i < PATTERN_CACHE_SIZE; i++) {
+    if (cache[i] != NULL && !cache[i]->busy) {
+      destroy_entry(cache[i]);
+      cache[i] = NULL;
+    }
+  }
+  pthread_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,16 @@
+#ifndef SRC_GREP_S21_GREP_CACHE_H_
+#define SRC_GREP_S21_GREP_CACHE_H_
+
+#include <stdbool.h>
+
+#include "s21_grep_matcher.h"
+
+#define PATTERN_CACHE_SIZE 32
+#define PATTERN_CACHE_SUBJECT_MAX (256u << 10)  // Буфер -i в кэше, байт
+
+Matcher* acquire_matcher(const char* pattern, bool ignore_case,
+                         MatchScope scope);
+void release_matcher(Matcher* matcher);
+void clear_matcher_cache(void);
+
+#endif  // SRC_GREP_S21_GREP_CACHE_H_
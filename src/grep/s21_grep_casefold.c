@@ -0,0 +1,266 @@
+#include "s21_grep_casefold.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SWAR_ONES 0x0101010101010101ull
+#define SWAR_HIGH_BITS 0x8080808080808080ull
+#define FOLD_ASCII_SIZE 128
+#define FOLD_BRACKET_SIZE (FOLD_ASCII_SIZE + 4)  // Перечисление и скобки
+
+/* Результат разбора выражения в квадратных скобках */
+typedef enum {
+  BRACKET_FOLDABLE,     // Можно заменить перечислением в нижнем регистре
+  BRACKET_UNSUPPORTED,  // Нужен REG_ICASE
+  BRACKET_INVALID       // Некорректное выражение
+} BracketKind;
+
+/* Именованный класс символов для [:имя:] (локаль C) */
+typedef struct {
+  const char* name;
+  int (*test)(int);
+} CharClass;
+
+static const CharClass kCharClasses[] = {
+    {"alpha", isalpha}, {"digit", isdigit}, {"alnum", isalnum},
+    {"upper", isupper}, {"lower", islower}, {"space", isspace},
+    {"blank", isblank}, {"punct", ispunct}, {"print", isprint},
+    {"graph", isgraph}, {"cntrl", iscntrl}, {"xdigit", isxdigit},
+};
+
+static char fold_char(char c) {
+  return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+/**
+ * Добавление в множество символов класса [:имя:]
+ * @param pattern Шаблон
+ * @param pos Позиция после "[:" (на выходе - после ":]")
+ * @param set Множество ASCII-символов
+ * @return false если класс не закрыт или неизвестен
+ */
+static bool add_char_class(const char* pattern, size_t* pos, bool* set) {
+  const char* close = strstr(pattern + *pos, ":]");
+  if (close == NULL) return false;
+  size_t length = (size_t)(close - (pattern + *pos));
+  for (size_t i = 0; i < sizeof(kCharClasses) / sizeof(kCharClasses[0]);
+       i++) {
+    if (strlen(kCharClasses[i].name) == length &&
+        strncmp(kCharClasses[i].name, pattern + *pos, length) == 0) {
+      for (int c = 0; c < FOLD_ASCII_SIZE; c++) {
+        if (kCharClasses[i].test(c)) set[c] = true;
+      }
+      *pos += length + 2;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Разбор выражения в квадратных скобках во множество ASCII-символов.
+ * Диапазоны считаются по кодам символов, классы - по локали C, как у
+ * regcomp в этой программе. Диапазон, границы которого в верхнем
+ * регистре идут в обратном порядке ([Z-a], [[-a]), некорректен, как и в
+ * GNU grep -i. Элементы сортировки [. .] и классы эквивалентности [= =] не
+ * поддерживаются
+ * @param pattern Шаблон
+ * @param pos Позиция после '[' (на выходе - после ']')
+ * @param set Множество для заполнения (FOLD_ASCII_SIZE элементов)
+ * @param negated Выражение начинается с '^'
+ * @return Вид выражения
+ */
+static BracketKind parse_bracket(const char* pattern, size_t* pos, bool* set,
+                                 bool* negated) {
+  size_t i = *pos;
+  bool first = true;
+  BracketKind kind = BRACKET_FOLDABLE;
+  memset(set, 0, FOLD_ASCII_SIZE * sizeof(bool));
+  *negated = pattern[i] == '^';
+  if (*negated) i++;
+
+  while (kind == BRACKET_FOLDABLE && pattern[i] != '\0' &&
+         (first || pattern[i] != ']')) {
+    unsigned char low = (unsigned char)pattern[i];
+    first = false;
+    if (low >= FOLD_ASCII_SIZE) {
+      kind = BRACKET_UNSUPPORTED;
+    } else if (low == '[' && (pattern[i + 1] == '.' ||
+                              pattern[i + 1] == '=')) {
+      kind = BRACKET_UNSUPPORTED;
+    } else if (low == '[' && pattern[i + 1] == ':') {
+      i += 2;
+      if (!add_char_class(pattern, &i, set)) kind = BRACKET_INVALID;
+    } else if (pattern[i + 1] == '-' && pattern[i + 2] != ']' &&
+               pattern[i + 2] != '\0') {
+      unsigned char high = (unsigned char)pattern[i + 2];
+      if (high >= FOLD_ASCII_SIZE) {
+        kind = BRACKET_UNSUPPORTED;
+      } else if (low > high || toupper(low) > toupper(high) ||
+                 (high == '[' && strchr(":.=", pattern[i + 3]) != NULL)) {
+        kind = BRACKET_INVALID;
+      }
+      for (unsigned c = low; kind == BRACKET_FOLDABLE && c <= high; c++) {
+        set[c] = true;
+      }
+      i += 3;
+    } else {
+      set[low] = true;
+      i++;
+    }
+  }
+  if (kind == BRACKET_FOLDABLE && pattern[i] != ']') kind = BRACKET_INVALID;
+  *pos = pattern[i] == ']' ? i + 1 : i;
+  return kind;
+}
+
+/**
+ * Запись множества символов в нижнем регистре как выражения в
+ * квадратных скобках: ']' ставится первым, '^' - не первым, '-' -
+ * последним, чтобы они не получили особого смысла
+ * @param set Множество символов
+ * @param negated Выражение инвертировано
+ * @param out Куда писать (не больше FOLD_BRACKET_SIZE байт)
+ * @return Позиция после записанного выражения
+ */
+static char* write_folded_bracket(const bool* set, bool negated, char* out) {
+  bool folded[FOLD_ASCII_SIZE] = {false};
+  for (int c = 1; c < FOLD_ASCII_SIZE; c++) {
+    if (set[c]) folded[(unsigned char)fold_char((char)c)] = true;
+  }
+
+  char* start = out;
+  *out++ = '[';
+  if (negated) *out++ = '^';
+  char* members = out;
+  if (folded[']']) *out++ = ']';
+  for (int c = 1; c < FOLD_ASCII_SIZE; c++) {
+    if (folded[c] && c != ']' && c != '^' && c != '-') *out++ = (char)c;
+  }
+  if (folded['^'] && out == members && !folded['-']) {
+    // Единственный символ '^': [^^] или \^ без скобок
+    if (negated) {
+      *out++ = '^';
+    } else {
+      out = start;
+      *out++ = '\\';
+      *out++ = '^';
+      return out;
+    }
+  } else if (folded['^'] && out == members) {
+    *out++ = '-';
+    *out++ = '^';
+  } else {
+    if (folded['^']) *out++ = '^';
+    if (folded['-']) *out++ = '-';
+  }
+  *out++ = ']';
+  return out;
+}
+
+/**
+ * Проверка, можно ли заменить REG_ICASE свертыванием регистра.
+ * Подходят шаблоны только из ASCII без элементов [. .] и [= =] и без
+ * экранированных букв, кроме \w \W \s \S \b \B, смысл которых не
+ * меняется при переводе текста в нижний регистр. Некорректные
+ * выражения в квадратных скобках отклоняет fold_pattern
+ * @param pattern Шаблон
+ * @return true если свертывание дает тот же результат, что и REG_ICASE
+ */
+bool can_fold_pattern(const char* pattern) {
+  bool foldable = true;
+  size_t i = 0;
+  while (foldable && pattern[i] != '\0') {
+    unsigned char c = (unsigned char)pattern[i];
+    if (c >= 0x80) {
+      foldable = false;
+    } else if (c == '[') {
+      bool set[FOLD_ASCII_SIZE], negated;
+      i++;
+      foldable =
+          parse_bracket(pattern, &i, set, &negated) != BRACKET_UNSUPPORTED;
+    } else if (c == '\\' && pattern[i + 1] != '\0') {
+      unsigned char next = (unsigned char)pattern[i + 1];
+      if (((next >= 'a' && next <= 'z') || (next >= 'A' && next <= 'Z')) &&
+          strchr("wWsSbB", next) == NULL) {
+        foldable = false;
+      }
+      i += 2;
+    } else {
+      i++;
+    }
+  }
+  return foldable;
+}
+
+/**
+ * Перевод шаблона в нижний регистр. Буквы после '\' вне квадратных
+ * скобок сохраняются (\W и \w - разные классы). Выражение в квадратных
+ * скобках заменяется перечислением его символов в нижнем регистре:
+ * границы диапазона сравниваются по кодам, и свернутый диапазон мог бы
+ * потерять символы между 'Z' и 'a' ([A-z] с -i совпадает с '_' и '['),
+ * а классы вроде [:upper:] зависят от регистра текста
+ * @param pattern Шаблон, прошедший can_fold_pattern
+ * @return Шаблон в динамической памяти или NULL при нехватке памяти и
+ *         некорректном выражении в квадратных скобках
+ */
+char* fold_pattern(const char* pattern) {
+  size_t brackets = 0;
+  for (const char* p = strchr(pattern, '['); p != NULL;
+       p = strchr(p + 1, '[')) {
+    brackets++;
+  }
+  char* folded = malloc(strlen(pattern) + brackets * FOLD_BRACKET_SIZE + 1);
+  if (folded == NULL) return NULL;
+
+  char* out = folded;
+  size_t i = 0;
+  while (pattern[i] != '\0') {
+    char c = pattern[i];
+    if (c == '\\' && pattern[i + 1] != '\0') {
+      *out++ = c;
+      *out++ = pattern[i + 1];
+      i += 2;
+    } else if (c == '[') {
+      bool set[FOLD_ASCII_SIZE], negated;
+      i++;
+      if (parse_bracket(pattern, &i, set, &negated) != BRACKET_FOLDABLE) {
+        free(folded);
+        return NULL;
+      }
+      out = write_folded_bracket(set, negated, out);
+    } else {
+      *out++ = fold_char(c);
+      i++;
+    }
+  }
+  *out = '\0';
+  return folded;
+}
+
+/**
+ * Перевод ASCII-текста в нижний регистр по 8 байт за шаг (SWAR).
+ * Для байтов 0..127 сложение с константой выставляет старший бит, если
+ * байт не меньше 'A' (и отдельно - если больше 'Z'); их разность дает
+ * маску заглавных букв, которая сдвигом превращается в бит 0x20.
+ * Байты >= 0x80 исключаются маской ~word и не меняются
+ * @param text Исходный текст
+ * @param folded Буфер результата (может совпадать с text)
+ * @param length Длина текста
+ */
+void fold_ascii(const char* text, char* folded, size_t length) {
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, text + i, sizeof(word));
+    uint64_t low7 = word & ~SWAR_HIGH_BITS;
+    uint64_t at_least_a = low7 + (0x80 - 'A') * SWAR_ONES;
+    uint64_t above_z = low7 + (0x80 - 'Z' - 1) * SWAR_ONES;
+    uint64_t upper = (at_least_a ^ above_z) & ~word & SWAR_HIGH_BITS;
+    word |= upper >> 2;
+    memcpy(folded + i, &word, sizeof(word));
+  }
+  for (; i < length; i++) folded[i] = fold_char(text[i]);
+}
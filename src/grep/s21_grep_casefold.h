@@ -0,0 +1,11 @@
+#ifndef SRC_GREP_S21_GREP_CASEFOLD_H_
+#define SRC_GREP_S21_GREP_CASEFOLD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+bool can_fold_pattern(const char* pattern);
+char* fold_pattern(const char* pattern);
+void fold_ascii(const char* text, char* folded, size_t length);
+
+#endif  // SRC_GREP_S21_GREP_CASEFOLD_H_
@@ -0,0 +1,262 @@
+#include "s21_grep_decompress.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+/* Поток распаковки: декодер работает в отдельном потоке и складывает
+ * блоки в ограниченную кольцевую очередь, а поиск забирает их через
+ * обычный FILE*. Блок в голове очереди принадлежит читателю, свободные
+ * слоты за хвостом - декодеру, поэтому данные копируются без блокировки */
+typedef struct {
+  unsigned char blocks[DECOMPRESS_QUEUE_LENGTH][DECOMPRESS_BLOCK_SIZE];
+  size_t sizes[DECOMPRESS_QUEUE_LENGTH];
+  size_t head;      // Номер блока, который читается сейчас
+  size_t count;     // Количество заполненных блоков
+  size_t read_pos;  // Позиция чтения внутри головного блока
+  bool finished;    // Декодер завершил работу
+  bool failed;      // Ошибка чтения или поврежденные данные
+  bool cancelled;   // Читатель закрыл поток раньше конца данных
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+  pthread_t thread;
+  FILE* raw;
+} DecompressStream;
+
+/**
+ * Определение формата сжатия по сигнатуре. Используется pread, поэтому
+ * позиция чтения FILE* не меняется
+ * @param file Открытый файл
+ * @return Формат или COMPRESSION_NONE
+ */
+CompressionFormat detect_compression(FILE* file) {
+  unsigned char magic[4] = {0};
+  ssize_t size = pread(fileno(file), magic, sizeof(magic), 0);
+  CompressionFormat format = COMPRESSION_NONE;
+
+  if (size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+    format = COMPRESSION_GZIP;
+  } else if (size == 4 && magic[0] == 0x28 && magic[1] == 0xb5 &&
+             magic[2] == 0x2f && magic[3] == 0xfd) {
+    format = COMPRESSION_ZSTD;
+  } else if (size == 4 && magic[0] == 0x04 && magic[1] == 0x22 &&
+             magic[2] == 0x4d && magic[3] == 0x18) {
+    format = COMPRESSION_LZ4;
+  }
+  return format;
+}
+
+/**
+ * Название формата для сообщений об ошибках
+ * @param format Формат сжатия
+ * @return Строка с названием
+ */
+const char* compression_name(CompressionFormat format) {
+  const char* name = "none";
+  if (format == COMPRESSION_GZIP) name = "gzip";
+  if (format == COMPRESSION_ZSTD) name = "zstd";
+  if (format == COMPRESSION_LZ4) name = "lz4";
+  return name;
+}
+
+/**
+ * Ожидание свободного слота очереди
+ * @param stream Поток распаковки
+ * @return Номер слота или -1, если читатель закрыл поток
+ */
+static long wait_free_slot(DecompressStream* stream) {
+  long slot = -1;
+  pthread_mutex_lock(&stream->lock);
+  while (stream->count == DECOMPRESS_QUEUE_LENGTH && !stream->cancelled) {
+    pthread_cond_wait(&stream->not_full, &stream->lock);
+  }
+  if (!stream->cancelled) {
+    slot = (long)((stream->head + stream->count) % DECOMPRESS_QUEUE_LENGTH);
+  }
+  pthread_mutex_unlock(&stream->lock);
+  return slot;
+}
+
+/**
+ * Публикация заполненного блока
+ * @param stream Поток распаковки
+ * @param slot Номер слота
+ * @param size Размер данных в блоке
+ */
+static void publish_slot(DecompressStream* stream, long slot, size_t size) {
+  pthread_mutex_lock(&stream->lock);
+  stream->sizes[slot] = size;
+  stream->count++;
+  pthread_cond_signal(&stream->not_empty);
+  pthread_mutex_unlock(&stream->lock);
+}
+
+/**
+ * Завершение работы декодера
+ * @param stream Поток распаковки
+ * @param failed Признак ошибки
+ */
+static void finish_stream(DecompressStream* stream, bool failed) {
+  pthread_mutex_lock(&stream->lock);
+  stream->finished = true;
+  stream->failed = failed;
+  pthread_cond_signal(&stream->not_empty);
+  pthread_mutex_unlock(&stream->lock);
+}
+
+/**
+ * Поток декодера gzip. Склеенные gzip-члены распаковываются подряд,
+ * как это делает zcat
+ * @param arg Поток распаковки
+ * @return NULL
+ */
+static void* gzip_decoder(void* arg) {
+  DecompressStream* stream = arg;
+  unsigned char input[DECOMPRESS_BLOCK_SIZE];
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  bool failed = inflateInit2(&zs, 15 + 32) != Z_OK;
+  bool done = failed;
+  bool inside_member = false;  // Член gzip начат, но еще не закончен
+
+  while (!done) {
+    long slot = wait_free_slot(stream);
+    if (slot < 0) break;
+
+    zs.next_out = stream->blocks[slot];
+    zs.avail_out = DECOMPRESS_BLOCK_SIZE;
+    while (!done && zs.avail_out > 0) {
+      if (zs.avail_in == 0) {
+        zs.avail_in = (uInt)fread(input, 1, sizeof(input), stream->raw);
+        zs.next_in = input;
+        if (zs.avail_in == 0) {
+          failed = ferror(stream->raw) != 0 || inside_member;
+          done = true;
+          break;
+        }
+      }
+      int status = inflate(&zs, Z_NO_FLUSH);
+      inside_member = status == Z_OK || status == Z_BUF_ERROR;
+      if (status == Z_STREAM_END) {
+        if (zs.avail_in == 0 && feof(stream->raw)) done = true;
+        if (!done) inflateReset(&zs);
+      } else if (!inside_member) {
+        failed = done = true;
+      }
+    }
+
+    size_t size = DECOMPRESS_BLOCK_SIZE - zs.avail_out;
+    if (size > 0) publish_slot(stream, slot, size);
+  }
+
+  inflateEnd(&zs);
+  finish_stream(stream, failed);
+  return NULL;
+}
+
+/**
+ * Чтение распакованных данных (функция read для fopencookie)
+ * @param cookie Поток распаковки
+ * @param buffer Буфер читателя
+ * @param size Размер буфера
+ * @return Количество байт, 0 в конце данных или -1 при ошибке
+ */
+static ssize_t decompress_read(void* cookie, char* buffer, size_t size) {
+  DecompressStream* stream = cookie;
+
+  pthread_mutex_lock(&stream->lock);
+  while (stream->count == 0 && !stream->finished) {
+    pthread_cond_wait(&stream->not_empty, &stream->lock);
+  }
+  bool empty = stream->count == 0;
+  bool failed = stream->failed;
+  size_t head = stream->head;
+  pthread_mutex_unlock(&stream->lock);
+
+  if (empty) return failed ? -1 : 0;
+
+  size_t available = stream->sizes[head] - stream->read_pos;
+  size_t copied = size < available ? size : available;
+  memcpy(buffer, stream->blocks[head] + stream->read_pos, copied);
+  stream->read_pos += copied;
+
+  if (stream->read_pos == stream->sizes[head]) {
+    pthread_mutex_lock(&stream->lock);
+    stream->head = (stream->head + 1) % DECOMPRESS_QUEUE_LENGTH;
+    stream->count--;
+    stream->read_pos = 0;
+    pthread_cond_signal(&stream->not_full);
+    pthread_mutex_unlock(&stream->lock);
+  }
+  return (ssize_t)copied;
+}
+
+/**
+ * Освобождение потока распаковки без закрытия исходного файла
+ * @param stream Поток распаковки
+ * @param started Был ли запущен поток декодера
+ */
+static void destroy_stream(DecompressStream* stream, bool started) {
+  if (started) {
+    pthread_mutex_lock(&stream->lock);
+    stream->cancelled = true;
+    pthread_cond_signal(&stream->not_full);
+    pthread_mutex_unlock(&stream->lock);
+    pthread_join(stream->thread, NULL);
+  }
+  pthread_mutex_destroy(&stream->lock);
+  pthread_cond_destroy(&stream->not_empty);
+  pthread_cond_destroy(&stream->not_full);
+  free(stream);
+}
+
+/**
+ * Закрытие потока: декодер останавливается, даже если данные прочитаны
+ * не до конца (ранний выход для флага -l)
+ * @param cookie Поток распаковки
+ * @return 0 при успехе
+ */
+static int decompress_close(void* cookie) {
+  DecompressStream* stream = cookie;
+  FILE* raw = stream->raw;
+  destroy_stream(stream, true);
+  return fclose(raw);
+}
+
+/**
+ * Открытие распакованного представления сжатого файла. При успехе
+ * полученный FILE* владеет raw и закрывает его сам, при ошибке raw
+ * остается открытым
+ * @param raw Открытый сжатый файл
+ * @param format Формат сжатия (из detect_compression)
+ * @param result Поток с распакованными данными (заполняется при успехе)
+ * @return 0 при успехе, ENOTSUP если формат не поддерживается этой
+ *         сборкой, иначе код ошибки выделения памяти или запуска потока
+ */
+int open_decompressed(FILE* raw, CompressionFormat format, FILE** result) {
+  *result = NULL;
+  if (format != COMPRESSION_GZIP) return ENOTSUP;
+
+  DecompressStream* stream = calloc(1, sizeof(DecompressStream));
+  if (stream == NULL) return ENOMEM;
+  stream->raw = raw;
+  pthread_mutex_init(&stream->lock, NULL);
+  pthread_cond_init(&stream->not_empty, NULL);
+  pthread_cond_init(&stream->not_full, NULL);
+
+  cookie_io_functions_t functions = {decompress_read, NULL, NULL,
+                                     decompress_close};
+  int error = pthread_create(&stream->thread, NULL, gzip_decoder, stream);
+  bool started = error == 0;
+  if (started) {
+    *result = fopencookie(stream, "r", functions);
+    if (*result == NULL) error = errno != 0 ? errno : ENOMEM;
+  }
+  if (*result == NULL) destroy_stream(stream, started);
+  return error;
+}
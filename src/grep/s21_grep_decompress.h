@@ -0,0 +1,21 @@
+#ifndef SRC_GREP_S21_GREP_DECOMPRESS_H_
+#define SRC_GREP_S21_GREP_DECOMPRESS_H_
+
+#include <stdio.h>
+
+#define DECOMPRESS_BLOCK_SIZE 65536
+#define DECOMPRESS_QUEUE_LENGTH 4
+
+/* Форматы сжатия, распознаваемые по первым байтам файла */
+typedef enum {
+  COMPRESSION_NONE,
+  COMPRESSION_GZIP,
+  COMPRESSION_ZSTD,
+  COMPRESSION_LZ4
+} CompressionFormat;
+
+CompressionFormat detect_compression(FILE* file);
+const char* compression_name(CompressionFormat format);
+int open_decompressed(FILE* raw, CompressionFormat format, FILE** result);
+
+#endif  // SRC_GREP_S21_GREP_DECOMPRESS_H_
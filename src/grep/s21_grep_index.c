@@ -0,0 +1,610 @@
+#include "s21_grep_index.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "s21_grep.h"
+#include "s21_reader.h"
+
+#define TRIGRAM_SPACE (1u << 24)
+#define INDEX_PATH_SIZE 4096
+
+static const char kRegexSpecials[] = ".[]()*+?{}|^$\\";
+
+/* Пара (триграмма, номер файла), упакованная так, что сортировка чисел
+ * упорядочивает пары сначала по триграмме, затем по файлу */
+typedef struct {
+  uint64_t* items;
+  size_t count;
+  size_t capacity;
+} PostingPairs;
+
+static unsigned char fold_byte(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c;
+}
+
+static uint32_t make_trigram(unsigned char a, unsigned char b,
+                             unsigned char c) {
+  return ((uint32_t)fold_byte(a) << 16) | ((uint32_t)fold_byte(b) << 8) |
+         fold_byte(c);
+}
+
+static int compare_names(const void* a, const void* b) {
+  return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static int compare_pairs(const void* a, const void* b) {
+  uint64_t x = *(const uint64_t*)a;
+  uint64_t y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Получение отсортированного списка обычных файлов каталога
+ * (без самого файла индекса)
+ * @param dir_path Путь к каталогу
+ * @param count Количество найденных файлов
+ * @return Массив имен (освобождается через free_index_directory) или NULL
+ * при ошибке чтения каталога или нехватке памяти
+ */
+char** list_index_directory(const char* dir_path, size_t* count) {
+  DIR* dir = opendir(dir_path);
+  if (dir == NULL) return NULL;
+
+  size_t capacity = 16;
+  char** names = malloc(capacity * sizeof(char*));
+  struct dirent* entry;
+  bool ok = names != NULL;
+  *count = 0;
+
+  while (ok && (entry = readdir(dir)) != NULL) {
+    char path[INDEX_PATH_SIZE];
+    struct stat file_stat;
+    snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+    if (strcmp(entry->d_name, INDEX_FILE_NAME) == 0 ||
+        stat(path, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+      continue;
+    }
+    if (*count == capacity) {
+      capacity *= 2;
+      char** grown = realloc(names, capacity * sizeof(char*));
+      ok = grown != NULL;
+      if (!ok) break;
+      names = grown;
+    }
+    names[*count] = strdup(entry->d_name);
+    ok = names[*count] != NULL;
+    if (ok) (*count)++;
+  }
+  closedir(dir);
+
+  if (!ok) {
+    if (names != NULL) free_index_directory(names, *count);
+    *count = 0;
+    return NULL;
+  }
+  qsort(names, *count, sizeof(char*), compare_names);
+  return names;
+}
+
+/**
+ * Освобождение списка, полученного из list_index_directory
+ * @param names Массив имен
+ * @param count Количество имен
+ */
+void free_index_directory(char** names, size_t count) {
+  for (size_t i = 0; i < count; i++) free(names[i]);
+  free(names);
+}
+
+static bool append_pair(PostingPairs* pairs, uint32_t trigram,
+                        uint32_t file_id) {
+  if (pairs->count == pairs->capacity) {
+    size_t capacity = pairs->capacity ? pairs->capacity * 2 : 4096;
+    uint64_t* grown = realloc(pairs->items, capacity * sizeof(uint64_t));
+    if (grown == NULL) return false;
+    pairs->items = grown;
+    pairs->capacity = capacity;
+  }
+  pairs->items[pairs->count++] = ((uint64_t)trigram << 32) | file_id;
+  return true;
+}
+
+/**
+ * Сбор множества триграмм одного файла. Триграммы, содержащие перевод
+ * строки, не сохраняются: шаблон никогда не совпадает через границу строк
+ * @param file Открытый файл
+ * @param file_id Номер файла в индексе
+ * @param seen Битовая карта уже встреченных триграмм (на выходе пустая)
+ * @param pairs Накопитель пар (триграмма, файл)
+ * @return true при успехе
+ */
+static bool collect_file_trigrams(FILE* file, uint32_t file_id,
+                                  unsigned char* seen, PostingPairs* pairs) {
+  BlockReader reader;
+  const char* block;
+  size_t length;
+  unsigned char prev[2] = {'\n', '\n'};
+  size_t first_pair = pairs->count;
+  bool ok = init_block_reader(&reader, file, false);
+
+  while (ok && read_block(&reader, &block, &length)) {
+    for (size_t i = 0; ok && i < length; i++) {
+      unsigned char c = (unsigned char)block[i];
+      if (c != '\n' && prev[0] != '\n' && prev[1] != '\n') {
+        uint32_t trigram = make_trigram(prev[0], prev[1], c);
+        if (!(seen[trigram >> 3] & (1u << (trigram & 7)))) {
+          seen[trigram >> 3] |= (unsigned char)(1u << (trigram & 7));
+          ok = append_pair(pairs, trigram, file_id);
+        }
+      }
+      prev[0] = prev[1];
+      prev[1] = c;
+    }
+  }
+
+  // Очищаем только установленные биты, а не всю карту
+  for (size_t i = first_pair; i < pairs->count; i++) {
+    uint32_t trigram = (uint32_t)(pairs->items[i] >> 32);
+    seen[trigram >> 3] = 0;
+  }
+  ok = ok && !reader.failed;
+  free_block_reader(&reader);
+  return ok;
+}
+
+/**
+ * Запись индекса во временный файл с последующим переименованием
+ * @param dir_path Каталог индекса
+ * @param names Имена файлов
+ * @param files Записи о файлах
+ * @param count Количество файлов
+ * @param pairs Отсортированные пары (триграмма, файл)
+ * @return 0 при успехе, -1 при ошибке
+ */
+static int write_index(const char* dir_path, char** names,
+                       const IndexFileEntry* files, size_t count,
+                       const PostingPairs* pairs) {
+  char path[INDEX_PATH_SIZE], tmp_path[INDEX_PATH_SIZE + 8];
+  snprintf(path, sizeof(path), "%s/%s", dir_path, INDEX_FILE_NAME);
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+  uint32_t trigram_count = 0;
+  for (size_t i = 0; i < pairs->count; i++) {
+    if (i == 0 || (pairs->items[i] >> 32) != (pairs->items[i - 1] >> 32)) {
+      trigram_count++;
+    }
+  }
+
+  IndexHeader header = {0};
+  memcpy(header.magic, INDEX_MAGIC, INDEX_MAGIC_SIZE);
+  header.file_count = (uint32_t)count;
+  header.trigram_count = trigram_count;
+  header.files_offset = sizeof(IndexHeader);
+  header.trigrams_offset =
+      header.files_offset + count * sizeof(IndexFileEntry);
+  header.postings_offset =
+      header.trigrams_offset + trigram_count * sizeof(IndexTrigramEntry);
+  header.names_offset =
+      header.postings_offset + pairs->count * sizeof(uint32_t);
+
+  FILE* out = fopen(tmp_path, "wb");
+  if (out == NULL) return -1;
+
+  bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+  if (count > 0) ok = ok && fwrite(files, sizeof(*files), count, out) == count;
+
+  for (size_t i = 0; ok && i < pairs->count;) {
+    IndexTrigramEntry entry = {(uint32_t)(pairs->items[i] >> 32), 0, i};
+    while (i < pairs->count && (pairs->items[i] >> 32) == entry.trigram) {
+      entry.posting_count++;
+      i++;
+    }
+    ok = fwrite(&entry, sizeof(entry), 1, out) == 1;
+  }
+  for (size_t i = 0; ok && i < pairs->count; i++) {
+    uint32_t file_id = (uint32_t)pairs->items[i];
+    ok = fwrite(&file_id, sizeof(file_id), 1, out) == 1;
+  }
+  for (size_t i = 0; ok && i < count; i++) {
+    ok = fwrite(names[i], 1, files[i].name_length, out) == files[i].name_length;
+  }
+
+  if (fclose(out) != 0) ok = false;
+  if (ok && rename(tmp_path, path) != 0) ok = false;
+  if (!ok) remove(tmp_path);
+  return ok ? 0 : -1;
+}
+
+/**
+ * Построение триграммного индекса для всех обычных файлов каталога
+ * (флаг --build-index)
+ * @param dir_path Путь к каталогу
+ * @return 0 при успехе, -1 при ошибке
+ */
+int build_index(const char* dir_path) {
+  size_t count = 0;
+  char** names = list_index_directory(dir_path, &count);
+  if (names == NULL) {
+    print_path_error("Не удалось прочитать каталог", dir_path);
+    return -1;
+  }
+
+  IndexFileEntry* files = calloc(count ? count : 1, sizeof(IndexFileEntry));
+  unsigned char* seen = calloc(TRIGRAM_SPACE / 8, 1);
+  PostingPairs pairs = {NULL, 0, 0};
+  uint32_t name_offset = 0;
+  int result = (files != NULL && seen != NULL) ? 0 : -1;
+  if (result != 0) {
+    print_path_error("Недостаточно памяти для индекса каталога", dir_path);
+  }
+
+  for (size_t i = 0; result == 0 && i < count; i++) {
+    char path[INDEX_PATH_SIZE];
+    struct stat file_stat;
+    snprintf(path, sizeof(path), "%s/%s", dir_path, names[i]);
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL || fstat(fileno(file), &file_stat) != 0) {
+      print_path_error("Не удалось открыть файл", path);
+      if (file != NULL) fclose(file);
+      result = -1;
+      break;
+    }
+
+    files[i].size = (uint64_t)file_stat.st_size;
+    files[i].mtime_sec = (int64_t)file_stat.st_mtim.tv_sec;
+    files[i].mtime_nsec = (int64_t)file_stat.st_mtim.tv_nsec;
+    files[i].name_offset = name_offset;
+    files[i].name_length = (uint32_t)strlen(names[i]);
+    name_offset += files[i].name_length;
+
+    if (!collect_file_trigrams(file, (uint32_t)i, seen, &pairs)) {
+      print_path_error("Не удалось прочитать файл", path);
+      result = -1;
+    }
+    fclose(file);
+  }
+
+  if (result == 0) {
+    qsort(pairs.items, pairs.count, sizeof(uint64_t), compare_pairs);
+    result = write_index(dir_path, names, files, count, &pairs);
+    if (result != 0) print_path_error("Не удалось записать индекс в", dir_path);
+  }
+
+  free(pairs.items);
+  free(seen);
+  free(files);
+  free_index_directory(names, count);
+  return result;
+}
+
+/**
+ * Проверка, что все части индекса и все ссылки из записей лежат внутри
+ * файла: поврежденный или обрезанный индекс не должен приводить к
+ * чтению за пределами отображения
+ * @param index Индекс с заполненными data, size и header
+ * @return true если индекс можно использовать
+ */
+static bool index_is_valid(const TrigramIndex* index) {
+  const IndexHeader* header = index->header;
+  uint64_t files_end = header->files_offset + (uint64_t)header->file_count *
+                                                  sizeof(IndexFileEntry);
+  uint64_t trigrams_end =
+      header->trigrams_offset +
+      (uint64_t)header->trigram_count * sizeof(IndexTrigramEntry);
+  if (memcmp(header->magic, INDEX_MAGIC, INDEX_MAGIC_SIZE) != 0 ||
+      header->files_offset < sizeof(IndexHeader) ||
+      header->files_offset % sizeof(uint64_t) != 0 ||
+      header->trigrams_offset % sizeof(uint64_t) != 0 ||
+      header->postings_offset % sizeof(uint32_t) != 0 ||
+      header->files_offset > header->trigrams_offset ||
+      header->trigrams_offset > header->postings_offset ||
+      files_end > header->trigrams_offset ||
+      trigrams_end > header->postings_offset ||
+      header->postings_offset > header->names_offset ||
+      header->names_offset > index->size) {
+    return false;
+  }
+
+  const IndexFileEntry* files =
+      (const IndexFileEntry*)(index->data + header->files_offset);
+  uint64_t names_size = index->size - header->names_offset;
+  for (uint32_t i = 0; i < header->file_count; i++) {
+    if ((uint64_t)files[i].name_offset + files[i].name_length > names_size) {
+      return false;
+    }
+  }
+
+  const IndexTrigramEntry* trigrams =
+      (const IndexTrigramEntry*)(index->data + header->trigrams_offset);
+  uint64_t posting_total =
+      (header->names_offset - header->postings_offset) / sizeof(uint32_t);
+  for (uint32_t i = 0; i < header->trigram_count; i++) {
+    if (trigrams[i].posting_offset > posting_total ||
+        trigrams[i].posting_count >
+            posting_total - trigrams[i].posting_offset) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Открытие индекса каталога через mmap и проверка его структуры
+ * @param index Структура для заполнения
+ * @param dir_path Путь к каталогу
+ * @return 0 при успехе, -1 если индекса нет или он поврежден (тогда
+ * каталог просматривается полностью)
+ */
+int open_index(TrigramIndex* index, const char* dir_path) {
+  char path[INDEX_PATH_SIZE];
+  struct stat file_stat;
+  snprintf(path, sizeof(path), "%s/%s", dir_path, INDEX_FILE_NAME);
+  memset(index, 0, sizeof(*index));
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return -1;
+  if (fstat(fd, &file_stat) != 0 ||
+      (size_t)file_stat.st_size < sizeof(IndexHeader)) {
+    close(fd);
+    return -1;
+  }
+
+  void* data = map_guarded_file(fd, (size_t)file_stat.st_size, &index->guard);
+  close(fd);
+  if (data == NULL) return -1;
+
+  index->data = data;
+  index->size = (size_t)file_stat.st_size;
+  index->header = data;
+
+  if (!index_is_valid(index)) {
+    close_index(index);
+    return -1;
+  }
+
+  const IndexHeader* header = index->header;
+  index->files = (const IndexFileEntry*)(index->data + header->files_offset);
+  index->trigrams =
+      (const IndexTrigramEntry*)(index->data + header->trigrams_offset);
+  index->postings = (const uint32_t*)(index->data + header->postings_offset);
+  index->names = (const char*)(index->data + header->names_offset);
+  return 0;
+}
+
+/**
+ * Закрытие индекса
+ * @param index Открытый индекс
+ */
+void close_index(TrigramIndex* index) {
+  if (index->data != NULL) {
+    unmap_guarded_file((void*)index->data, index->size, index->guard);
+  }
+  memset(index, 0, sizeof(*index));
+}
+
+/**
+ * Поиск записи о файле по имени (имена в индексе отсортированы)
+ * @param index Открытый индекс
+ * @param name Имя файла внутри каталога
+ * @return Номер записи или -1, если файла нет в индексе
+ */
+long find_index_entry(const TrigramIndex* index, const char* name) {
+  size_t name_length = strlen(name);
+  size_t low = 0, high = index->header->file_count;
+
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    const IndexFileEntry* entry = &index->files[mid];
+    size_t common = entry->name_length < name_length ? entry->name_length
+                                                     : name_length;
+    int cmp = memcmp(index->names + entry->name_offset, name, common);
+    if (cmp == 0) {
+      cmp = (entry->name_length > name_length) -
+            (entry->name_length < name_length);
+    }
+    if (cmp == 0) return (long)mid;
+    if (cmp < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return -1;
+}
+
+/**
+ * Проверка, что файл не изменился после построения индекса. Если сам
+ * индекс укоротили после открытия, часть его читается как нули, и файл
+ * не пропускается
+ * @param index Открытый индекс
+ * @param file_id Номер записи
+ * @param file_stat Текущие сведения о файле
+ * @return true если размер и время изменения совпадают
+ */
+bool index_entry_is_fresh(const TrigramIndex* index, size_t file_id,
+                          const struct stat* file_stat) {
+  const IndexFileEntry* entry = &index->files[file_id];
+  return !guarded_mapping_truncated(index->guard) &&
+         entry->size == (uint64_t)file_stat->st_size &&
+         entry->mtime_sec == (int64_t)file_stat->st_mtim.tv_sec &&
+         entry->mtime_nsec == (int64_t)file_stat->st_mtim.tv_nsec;
+}
+
+static const IndexTrigramEntry* find_trigram(const TrigramIndex* index,
+                                             uint32_t trigram) {
+  size_t low = 0, high = index->header->trigram_count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (index->trigrams[mid].trigram == trigram) return &index->trigrams[mid];
+    if (index->trigrams[mid].trigram < trigram) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return NULL;
+}
+
+/* Пропуск выражения в квадратных скобках, pos указывает на '[' */
+static size_t skip_bracket(const char* pattern, size_t pos) {
+  pos++;
+  if (pattern[pos] == '^') pos++;
+  if (pattern[pos] == ']') pos++;
+  while (pattern[pos] != '\0' && pattern[pos] != ']') {
+    if (pattern[pos] == '[' && pattern[pos + 1] != '\0' &&
+        strchr(":.=", pattern[pos + 1]) != NULL) {
+      char kind = pattern[pos + 1];
+      pos += 2;
+      while (pattern[pos] != '\0' &&
+             !(pattern[pos] == kind && pattern[pos + 1] == ']')) {
+        pos++;
+      }
+      if (pattern[pos] != '\0') pos += 2;
+    } else {
+      pos++;
+    }
+  }
+  return pattern[pos] == ']' ? pos + 1 : pos;
+}
+
+/* Пропуск одного элемента шаблона: экранированного символа, скобочного
+ * выражения, группы или обычного символа */
+static size_t skip_atom(const char* pattern, size_t pos) {
+  if (pattern[pos] == '\\') return pattern[pos + 1] ? pos + 2 : pos + 1;
+  if (pattern[pos] == '[') return skip_bracket(pattern, pos);
+  if (pattern[pos] == '(') {
+    pos++;
+    while (pattern[pos] != '\0' && pattern[pos] != ')') {
+      pos = skip_atom(pattern, pos);
+    }
+    return pattern[pos] == ')' ? pos + 1 : pos;
+  }
+  return pos + 1;
+}
+
+/**
+ * Пересечение множества файлов альтернативы со списком файлов триграмм
+ * строки-литерала
+ * @param index Открытый индекс
+ * @param run Литерал
+ * @param length Длина литерала
+ * @param alternative Множество файлов альтернативы
+ * @param hits Рабочий массив
+ */
+static void intersect_run(const TrigramIndex* index, const char* run,
+                          size_t length, bool* alternative, bool* hits) {
+  size_t file_count = index->header->file_count;
+  for (size_t i = 0; i + 2 < length; i++) {
+    const IndexTrigramEntry* entry =
+        find_trigram(index, make_trigram((unsigned char)run[i],
+                                         (unsigned char)run[i + 1],
+                                         (unsigned char)run[i + 2]));
+    memset(hits, 0, file_count * sizeof(bool));
+    if (entry != NULL) {
+      const uint32_t* posting = index->postings + entry->posting_offset;
+      for (uint32_t p = 0; p < entry->posting_count; p++) {
+        if (posting[p] < file_count) hits[posting[p]] = true;
+      }
+    }
+    for (size_t f = 0; f < file_count; f++) alternative[f] &= hits[f];
+  }
+}
+
+/**
+ * Отбор файлов для одной альтернативы шаблона по ее обязательным литералам.
+ * Символ перед '*', '?' или '{' необязателен и разрывает литерал
+ * @param index Открытый индекс
+ * @param pattern Шаблон
+ * @param pos Начало альтернативы (на выходе - ее конец)
+ * @param alternative Множество файлов альтернативы
+ * @param hits Рабочий массив
+ * @return true если нашлась хотя бы одна триграмма
+ */
+static bool narrow_alternative(const TrigramIndex* index, const char* pattern,
+                               size_t* pos, bool* alternative, bool* hits) {
+  char run[INDEX_PATH_SIZE];
+  size_t length = 0;
+  bool constrained = false;
+  size_t i = *pos;
+
+  while (pattern[i] != '\0' && pattern[i] != '|') {
+    char literal = '\0';
+    bool is_literal = false;
+    size_t next = skip_atom(pattern, i);
+
+    if (pattern[i] == '\\' && pattern[i + 1] != '\0' &&
+        strchr(kRegexSpecials, pattern[i + 1]) != NULL) {
+      literal = pattern[i + 1];
+      is_literal = true;
+    } else if (strchr(kRegexSpecials, pattern[i]) == NULL) {
+      literal = pattern[i];
+      is_literal = true;
+    } else if (pattern[i] == '{') {
+      while (pattern[next - 1] != '}' && pattern[next] != '\0') next++;
+    }
+
+    bool optional = pattern[next] == '*' || pattern[next] == '?' ||
+                    pattern[next] == '{';
+    if (is_literal && !optional) {
+      if (length == sizeof(run)) {
+        intersect_run(index, run, length, alternative, hits);
+        constrained = true;
+        length = 0;
+      }
+      run[length++] = literal;
+    }
+    if (!is_literal || optional || pattern[next] == '+') {
+      if (length >= 3) {
+        intersect_run(index, run, length, alternative, hits);
+        constrained = true;
+      }
+      length = 0;
+    }
+    i = next;
+  }
+
+  if (length >= 3) {
+    intersect_run(index, run, length, alternative, hits);
+    constrained = true;
+  }
+  *pos = i;
+  return constrained;
+}
+
+/**
+ * Отбор файлов, которые могут содержать совпадение с шаблоном.
+ * Шаблон разбивается на альтернативы верхнего уровня; файл-кандидат
+ * должен содержать все триграммы обязательных литералов хотя бы одной
+ * из них
+ * @param index Открытый индекс
+ * @param pattern Шаблон (расширенное регулярное выражение)
+ * @param candidates Массив размера file_count для результата
+ * @return false если шаблон не дает ограничений (нужен полный поиск)
+ */
+bool collect_index_candidates(const TrigramIndex* index, const char* pattern,
+                              bool* candidates) {
+  size_t file_count = index->header->file_count;
+  bool* alternative = malloc((file_count + 1) * sizeof(bool));
+  bool* hits = malloc((file_count + 1) * sizeof(bool));
+  bool constrained = alternative != NULL && hits != NULL;
+  size_t pos = 0;
+
+  memset(candidates, 0, file_count * sizeof(bool));
+  while (constrained) {
+    for (size_t f = 0; f < file_count; f++) alternative[f] = true;
+    constrained = narrow_alternative(index, pattern, &pos, alternative, hits);
+    for (size_t f = 0; f < file_count; f++) candidates[f] |= alternative[f];
+    if (pattern[pos] == '\0') break;
+    pos++;
+  }
+
+  free(alternative);
+  free(hits);
+  return constrained;
+}
@@ -0,0 +1,64 @@
+#ifndef SRC_GREP_S21_GREP_INDEX_H_
+#define SRC_GREP_S21_GREP_INDEX_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#define INDEX_FILE_NAME ".s21_grep.idx"
+#define INDEX_MAGIC "S21GIDX1"
+#define INDEX_MAGIC_SIZE 8
+
+/* Заголовок файла индекса. Все смещения считаются от начала файла,
+ * числа записаны в порядке байт машины, собравшей индекс */
+typedef struct {
+  char magic[INDEX_MAGIC_SIZE];
+  uint32_t file_count;     // Количество проиндексированных файлов
+  uint32_t trigram_count;  // Количество различных триграмм
+  uint64_t files_offset;   // Таблица IndexFileEntry
+  uint64_t trigrams_offset;  // Таблица IndexTrigramEntry (по возрастанию)
+  uint64_t postings_offset;  // Списки номеров файлов (uint32_t)
+  uint64_t names_offset;     // Имена файлов без завершающего нуля
+} IndexHeader;
+
+/* Запись о файле: имя и данные для проверки актуальности */
+typedef struct {
+  uint64_t size;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+  uint32_t name_offset;  // Смещение имени относительно names_offset
+  uint32_t name_length;
+} IndexFileEntry;
+
+/* Триграмма и ее список файлов (posting list) */
+typedef struct {
+  uint32_t trigram;
+  uint32_t posting_count;
+  uint64_t posting_offset;  // Номер первого элемента в массиве postings
+} IndexTrigramEntry;
+
+/* Открытый (отображенный в память) индекс */
+typedef struct {
+  const unsigned char* data;
+  size_t size;
+  const IndexHeader* header;
+  const IndexFileEntry* files;
+  const IndexTrigramEntry* trigrams;
+  const uint32_t* postings;
+  const char* names;
+  int guard;  // Запись защищенного отображения (s21_reader.h)
+} TrigramIndex;
+
+char** list_index_directory(const char* dir_path, size_t* count);
+void free_index_directory(char** names, size_t count);
+int build_index(const char* dir_path);
+int open_index(TrigramIndex* index, const char* dir_path);
+void close_index(TrigramIndex* index);
+long find_index_entry(const TrigramIndex* index, const char* name);
+bool index_entry_is_fresh(const TrigramIndex* index, size_t file_id,
+                          const struct stat* file_stat);
+bool collect_index_candidates(const TrigramIndex* index, const char* pattern,
+                              bool* candidates);
+
+#endif  // SRC_GREP_S21_GREP_INDEX_H_
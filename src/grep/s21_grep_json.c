@@ -0,0 +1,317 @@
+#include "s21_grep_json.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "s21_grep.h"
+
+#define JSON_ONES 0x0101010101010101ull
+#define JSON_HIGHS 0x8080808080808080ull
+#define JSON_MAX_ESCAPE 6  // Самая длинная замена байта: \u00XX
+
+static const char kHexDigits[] = "0123456789abcdef";
+
+/* Начало записи о строке ({"type":"match","file":...,"line":) одинаково
+ * для всех строк файла, поэтому собирается один раз. Поиск в каждом
+ * файле начинается со сброса (reset_json_prefix): итоговой записи по
+ * файлу может не быть, например после ошибки чтения */
+static _Thread_local char* match_prefix;
+static _Thread_local size_t match_prefix_length;
+
+/**
+ * Есть ли в восьми байтах символ, который нельзя скопировать в строку
+ * JSON как есть: управляющий, кавычка, обратная косая черта или не-ASCII
+ * (его нужно проверить как UTF-8). Проверка без ветвлений по байтам
+ * @param word Восемь байт текста
+ * @return true если такой символ есть
+ */
+static inline bool has_special_byte(uint64_t word) {
+  uint64_t quote = word ^ (JSON_ONES * '"');
+  uint64_t slash = word ^ (JSON_ONES * '\\');
+  uint64_t control = (word - JSON_ONES * 0x20) & ~word;
+  uint64_t quotes = (quote - JSON_ONES) & ~quote;
+  uint64_t slashes = (slash - JSON_ONES) & ~slash;
+  return ((control | quotes | slashes | word) & JSON_HIGHS) != 0;
+}
+
+static inline bool is_special_byte(unsigned char c) {
+  return c < 0x20 || c == '"' || c == '\\' || c >= 0x80;
+}
+
+/**
+ * Пропуск байтов, которые копируются без изменений. Текст проверяется по
+ * восемь байт, побайтно - только слово с особым символом и хвост
+ * @param text Текст
+ * @param pos Начало проверки
+ * @param length Длина текста
+ * @return Позиция первого особого байта или length
+ */
+static size_t skip_plain_bytes(const char* text, size_t pos, size_t length) {
+  while (length - pos >= sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, text + pos, sizeof(word));
+    if (has_special_byte(word)) break;
+    pos += sizeof(word);
+  }
+  while (pos < length && !is_special_byte((unsigned char)text[pos])) pos++;
+  return pos;
+}
+
+/**
+ * Длина корректной последовательности UTF-8 (без сверхдлинных форм,
+ * суррогатов и символов после U+10FFFF)
+ * @param text Начало последовательности (байт >= 0x80)
+ * @param available Сколько байт осталось в тексте
+ * @return Длина последовательности или 0, если она некорректна
+ */
+static size_t utf8_sequence_length(const unsigned char* text,
+                                   size_t available) {
+  unsigned char lead = text[0];
+  size_t length = lead >= 0xf0 ? 4 : lead >= 0xe0 ? 3 : lead >= 0xc2 ? 2 : 0;
+  if (length == 0 || lead > 0xf4 || length > available) return 0;
+  for (size_t i = 1; i < length; i++) {
+    if ((text[i] & 0xc0) != 0x80) return 0;
+  }
+  if ((lead == 0xe0 && text[1] < 0xa0) || (lead == 0xed && text[1] >= 0xa0) ||
+      (lead == 0xf0 && text[1] < 0x90) || (lead == 0xf4 && text[1] >= 0x90)) {
+    return 0;
+  }
+  return length;
+}
+
+/**
+ * Запись экранированного байта. Байт вне корректного UTF-8 выводится как
+ * символ Latin-1 с тем же кодом, поэтому запись остается валидным JSON
+ * @param out Куда писать (не меньше JSON_MAX_ESCAPE байт)
+ * @param c Байт
+ * @return Позиция после замены
+ */
+static char* write_escape(char* out, unsigned char c) {
+  out[0] = '\\';
+  switch (c) {
+    case '"':
+    case '\\':
+      out[1] = (char)c;
+      return out + 2;
+    case '\n':
+      out[1] = 'n';
+      return out + 2;
+    case '\t':
+      out[1] = 't';
+      return out + 2;
+    case '\r':
+      out[1] = 'r';
+      return out + 2;
+    case '\b':
+      out[1] = 'b';
+      return out + 2;
+    case '\f':
+      out[1] = 'f';
+      return out + 2;
+    default:
+      memcpy(out + 1, "u00", 3);
+      out[4] = kHexDigits[c >> 4];
+      out[5] = kHexDigits[c & 0xf];
+      return out + JSON_MAX_ESCAPE;
+  }
+}
+
+/**
+ * Экранирование текста для строки JSON. Участки без особых символов
+ * копируются целиком
+ * @param out Куда писать (не меньше length * JSON_MAX_ESCAPE байт)
+ * @param text Текст (может содержать нулевые байты)
+ * @param length Длина текста
+ * @return Позиция после экранированного текста
+ */
+static char* escape_json(char* out, const char* text, size_t length) {
+  size_t pos = 0;
+
+  while (pos < length) {
+    size_t plain = skip_plain_bytes(text, pos, length);
+    memcpy(out, text + pos, plain - pos);
+    out += plain - pos;
+    pos = plain;
+    if (pos == length) break;
+
+    const unsigned char* c = (const unsigned char*)text + pos;
+    size_t sequence = *c >= 0x80 ? utf8_sequence_length(c, length - pos) : 0;
+    if (sequence > 0) {
+      memcpy(out, c, sequence);
+      out += sequence;
+      pos += sequence;
+    } else {
+      out = write_escape(out, *c);
+      pos++;
+    }
+  }
+  return out;
+}
+
+/**
+ * Вывод строки JSON в кавычках. Текст экранируется прямо в буфер вывода,
+ * без printf и промежуточных копий; только строка длиннее буфера
+ * экранируется во временную память
+ * @param writer Буфер вывода
+ * @param text Текст (может содержать нулевые байты)
+ * @param length Длина текста
+ */
+void writer_write_json_string(OutputWriter* writer, const char* text,
+                              size_t length) {
+  size_t needed = length * JSON_MAX_ESCAPE + 2;
+  if (needed > WRITER_BUFFER_SIZE - writer->length) writer_flush(writer);
+
+  if (needed <= WRITER_BUFFER_SIZE - writer->length) {
+    char* out = writer->data + writer->length;
+    *out++ = '"';
+    out = escape_json(out, text, length);
+    *out++ = '"';
+    writer->length = (size_t)(out - writer->data);
+    return;
+  }
+
+  char* escaped = malloc(needed);
+  if (escaped == NULL) {
+    writer->failed = true;
+    return;
+  }
+  char* out = escaped;
+  *out++ = '"';
+  out = escape_json(out, text, length);
+  *out++ = '"';
+  writer_write(writer, escaped, (size_t)(out - escaped));
+  free(escaped);
+}
+
+/**
+ * Сброс начала записи о строке (см. match_prefix). Вызывается перед
+ * поиском в очередном файле
+ */
+void reset_json_prefix(void) {
+  free(match_prefix);
+  match_prefix = NULL;
+}
+
+/**
+ * Сборка начала записи о строке для файла (см. match_prefix)
+ * @param filename Имя файла
+ * @return false при нехватке памяти
+ */
+static bool build_match_prefix(const char* filename) {
+  static const char kStart[] = "{\"type\":\"match\",\"file\":\"";
+  static const char kEnd[] = "\",\"line\":";
+  size_t length = strlen(filename);
+
+  match_prefix =
+      malloc(sizeof(kStart) + length * JSON_MAX_ESCAPE + sizeof(kEnd));
+  if (match_prefix == NULL) return false;
+  char* out = match_prefix;
+  memcpy(out, kStart, sizeof(kStart) - 1);
+  out = escape_json(out + sizeof(kStart) - 1, filename, length);
+  memcpy(out, kEnd, sizeof(kEnd) - 1);
+  match_prefix_length = (size_t)(out - match_prefix) + sizeof(kEnd) - 1;
+  return true;
+}
+
+/**
+ * Начало записи: {"type":"<type>","file":"<имя файла>"
+ * @param type Тип записи
+ * @param filename Имя файла
+ */
+static void write_record_start(const char* type, const char* filename) {
+  writer_write_string(&output, "{\"type\":\"");
+  writer_write_string(&output, type);
+  writer_write_string(&output, "\",\"file\":");
+  writer_write_json_string(&output, filename, strlen(filename));
+}
+
+/**
+ * Вывод границ всех совпадений в строке: [[начало,конец],...], смещения
+ * в байтах от начала строки, конец не включается
+ * @param matcher Подготовленный шаблон
+ * @param subject Строка для сопоставления
+ * @param length Длина строки
+ */
+static void write_submatches(const Matcher* matcher, const char* subject,
+                             size_t length) {
+  size_t pos = 0;
+  bool first = true;
+  regmatch_t match;
+
+  while (pos <= length && matcher_find(matcher, subject, pos, length, &match)) {
+    // Пустые совпадения пропускаются, как в выводе -o
+    if (match.rm_eo == match.rm_so) {
+      pos = (size_t)match.rm_so + 1;
+      continue;
+    }
+    if (!first) writer_write_char(&output, ',');
+    first = false;
+    writer_write_char(&output, '[');
+    writer_write_number(&output, (size_t)match.rm_so, 0);
+    writer_write_char(&output, ',');
+    writer_write_number(&output, (size_t)match.rm_eo, 0);
+    writer_write_char(&output, ']');
+    pos = (size_t)match.rm_eo;
+  }
+}
+
+/**
+ * Запись о строке в результате (флаг --json):
+ * {"type":"match","file":...,"line":N,"offset":N,"submatches":[...],
+ * "text":...}
+ * @param filename Имя файла
+ * @param line_number Номер строки
+ * @param offset Смещение начала строки в файле
+ * @param matcher Шаблон для поиска совпадений или NULL (для -v)
+ * @param line Строка без '\n'
+ * @param subject Строка для сопоставления (см. matcher_subject)
+ * @param length Длина строки
+ */
+void print_json_match(const char* filename, size_t line_number,
+                      size_t offset, const Matcher* matcher,
+                      const char* line, const char* subject, size_t length) {
+  if (match_prefix != NULL || build_match_prefix(filename)) {
+    writer_write(&output, match_prefix, match_prefix_length);
+  } else {
+    write_record_start("match", filename);
+    writer_write_string(&output, ",\"line\":");
+  }
+  writer_write_number(&output, line_number, 0);
+  writer_write_string(&output, ",\"offset\":");
+  writer_write_number(&output, offset, 0);
+  writer_write_string(&output, ",\"submatches\":[");
+  if (matcher != NULL) write_submatches(matcher, subject, length);
+  writer_write_string(&output, "],\"text\":");
+  writer_write_json_string(&output, line, length);
+  writer_write_string(&output, "}\n");
+}
+
+/**
+ * Итоговая запись по файлу для -c ({"type":"count",...,"count":N})
+ * и -l ({"type":"file",...})
+ * @param filename Имя файла
+ * @param match_count Количество строк в результате
+ */
+void print_json_summary(const char* filename, size_t match_count) {
+  reset_json_prefix();
+
+  if (options.count_only && !options.files_name_only) {
+    write_record_start("count", filename);
+    writer_write_string(&output, ",\"count\":");
+    writer_write_number(&output, match_count, 0);
+    writer_write_string(&output, "}\n");
+  } else if (options.files_name_only && match_count > 0) {
+    write_record_start("file", filename);
+    writer_write_string(&output, "}\n");
+  }
+}
+
+/**
+ * Запись о совпадении в двоичном файле ({"type":"binary",...})
+ * @param filename Имя файла
+ */
+void print_json_binary(const char* filename) {
+  write_record_start("binary", filename);
+  writer_write_string(&output, "}\n");
+}
@@ -0,0 +1,18 @@
+#ifndef SRC_GREP_S21_GREP_JSON_H_
+#define SRC_GREP_S21_GREP_JSON_H_
+
+#include <stddef.h>
+
+#include "s21_grep_matcher.h"
+#include "s21_writer.h"
+
+void writer_write_json_string(OutputWriter* writer, const char* text,
+                              size_t length);
+void reset_json_prefix(void);
+void print_json_match(const char* filename, size_t line_number,
+                      size_t offset, const Matcher* matcher,
+                      const char* line, const char* subject, size_t length);
+void print_json_summary(const char* filename, size_t match_count);
+void print_json_binary(const char* filename);
+
+#endif  // SRC_GREP_S21_GREP_JSON_H_
@@ -0,0 +1,295 @@
+#include "s21_grep_matcher.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "s21_grep_casefold.h"
+#include "s21_stats.h"
+
+static const char kRegexSpecials[] = ".[]()*+?{}|^$\\";
+
+/**
+ * Подготовка шаблона к поиску
+ * @param matcher Структура для заполнения
+ * @param pattern Шаблон (расширенное регулярное выражение)
+ * @param ignore_case Флаг игнорирования регистра (-i)
+ * @param scope Часть строки, которая должна совпасть (-w, -x)
+ * @return 0 при успехе, -1 если выражение некорректно
+ */
+int init_matcher(Matcher* matcher, const char* pattern, bool ignore_case,
+                 MatchScope scope) {
+  memset(matcher, 0, sizeof(*matcher));
+  matcher->scope = scope;
+  matcher->fold_case = ignore_case && can_fold_pattern(pattern);
+  char* compiled =
+      matcher->fold_case ? fold_pattern(pattern) : strdup(pattern);
+  if (compiled == NULL) {
+    matcher->is_literal = true;  // regfree не нужен
+    return -1;
+  }
+
+  matcher->is_literal = (!ignore_case || matcher->fold_case) &&
+                        strpbrk(compiled, kRegexSpecials) == NULL;
+  if (matcher->is_literal) {
+    matcher->literal = compiled;
+    matcher->literal_length = strlen(compiled);
+    return 0;
+  }
+
+  int flags = REG_EXTENDED | REG_NEWLINE;
+  if (ignore_case && !matcher->fold_case) flags |= REG_ICASE;
+  uint64_t started = stats_start();
+  int status = regcomp(&matcher->regex, compiled, flags);
+  stats_stop(TIMER_REGEX_COMPILE, started);
+  stats_add(STAT_REGEX_COMPILES, 1);
+  free(compiled);
+  if (status != 0) {
+    matcher->is_literal = true;  // regfree не нужен
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Освобождение ресурсов шаблона
+ * @param matcher Подготовленный шаблон
+ */
+void free_matcher(Matcher* matcher) {
+  if (!matcher->is_literal) regfree(&matcher->regex);
+  free(matcher->literal);
+  free(matcher->folded);
+  memset(matcher, 0, sizeof(*matcher));
+  matcher->is_literal = true;
+}
+
+/**
+ * Получение текста, с которым сравнивается шаблон: для свертывания
+ * регистра это копия в нижнем регистре, иначе сам текст
+ * @param matcher Подготовленный шаблон
+ * @param text Исходный текст
+ * @param length Длина текста
+ * @return Текст той же длины или NULL при нехватке памяти
+ */
+const char* matcher_subject(Matcher* matcher, const char* text,
+                            size_t length) {
+  if (!matcher->fold_case) return text;
+
+  if (matcher->folded_capacity < length) {
+    char* grown = realloc(matcher->folded, length);
+    if (grown == NULL) return NULL;
+    matcher->folded = grown;
+    matcher->folded_capacity = length;
+  }
+  fold_ascii(text, matcher->folded, length);
+  return matcher->folded;
+}
+
+/**
+ * Освобождение буфера текста в нижнем регистре, если он больше limit
+ * байт. Меньший буфер остается для следующего поиска
+ * @param matcher Подготовленный шаблон
+ * @param limit Наибольший сохраняемый размер буфера
+ */
+void shrink_matcher_subject(Matcher* matcher, size_t limit) {
+  if (matcher->folded_capacity <= limit) return;
+  free(matcher->folded);
+  matcher->folded = NULL;
+  matcher->folded_capacity = 0;
+}
+
+/**
+ * Поиск первого совпадения в диапазоне [start, end) без учета -w и -x
+ * @param matcher Подготовленный шаблон
+ * @param subject Текст из matcher_subject
+ * @param start Начало диапазона
+ * @param end Конец диапазона
+ * @param match Смещения совпадения относительно subject
+ * @return true если совпадение найдено
+ */
+static bool find_any(const Matcher* matcher, const char* subject,
+                     size_t start, size_t end, regmatch_t* match) {
+  if (matcher->is_literal) {
+    stats_add(STAT_LITERAL_SEARCHES, 1);
+    const char* found = memmem(subject + start, end - start, matcher->literal,
+                               matcher->literal_length);
+    if (found == NULL) return false;
+    match->rm_so = (regoff_t)(found - subject);
+    match->rm_eo = match->rm_so + (regoff_t)matcher->literal_length;
+    return true;
+  }
+
+  stats_add(STAT_REGEXEC_CALLS, 1);
+  match->rm_so = (regoff_t)start;
+  match->rm_eo = (regoff_t)end;
+  return regexec(&matcher->regex, subject, 1, match, REG_STARTEND) == 0;
+}
+
+/**
+ * Поиск строки, целиком равной обычному шаблону (-x): вместо поиска
+ * подстроки сравниваются длина строки и ее байты
+ * @param matcher Подготовленный шаблон
+ * @param subject Текст из matcher_subject
+ * @param start Начало диапазона
+ * @param end Конец диапазона
+ * @param match Смещения совпадения относительно subject
+ * @return true если совпадение найдено
+ */
+static bool find_literal_line(const Matcher* matcher, const char* subject,
+                              size_t start, size_t end, regmatch_t* match) {
+  stats_add(STAT_LITERAL_SEARCHES, 1);
+  size_t pos = start;
+  if (pos > 0 && subject[pos - 1] != '\n') {
+    const char* newline = memchr(subject + pos, '\n', end - pos);
+    if (newline == NULL) return false;
+    pos = (size_t)(newline - subject) + 1;
+  }
+
+  while (pos <= end) {
+    const char* newline = memchr(subject + pos, '\n', end - pos);
+    size_t line_end = newline ? (size_t)(newline - subject) : end;
+    if (line_end - pos == matcher->literal_length &&
+        memcmp(subject + pos, matcher->literal, matcher->literal_length) ==
+            0) {
+      match->rm_so = (regoff_t)pos;
+      match->rm_eo = (regoff_t)line_end;
+      return true;
+    }
+    if (newline == NULL) break;
+    pos = line_end + 1;
+  }
+  return false;
+}
+
+/**
+ * Поиск совпадения со всей строкой (-x). Из совпадений, начинающихся в
+ * одном месте, находится самое длинное, а самое левое начинается не
+ * позже начала строки, подходящей целиком. Поэтому если первое
+ * совпадение в строке не занимает ее всю, строка пропускается
+ * @param matcher Подготовленный шаблон
+ * @param subject Текст из matcher_subject
+ * @param start Начало диапазона
+ * @param end Конец диапазона
+ * @param match Смещения совпадения относительно subject
+ * @return true если совпадение найдено
+ */
+static bool find_whole_line(const Matcher* matcher, const char* subject,
+                            size_t start, size_t end, regmatch_t* match) {
+  if (matcher->is_literal) {
+    return find_literal_line(matcher, subject, start, end, match);
+  }
+
+  while (start <= end && find_any(matcher, subject, start, end, match)) {
+    size_t from = (size_t)match->rm_so;
+    size_t to = (size_t)match->rm_eo;
+    if ((from == 0 || subject[from - 1] == '\n') &&
+        (to == end || subject[to] == '\n')) {
+      return true;
+    }
+
+    const char* newline = memchr(subject + from, '\n', end - from);
+    if (newline == NULL) break;
+    start = (size_t)(newline - subject) + 1;
+  }
+  return false;
+}
+
+/**
+ * Символ слова для -w: буква, цифра или '_'
+ * @param c Символ
+ * @return true если символ входит в слово
+ */
+static bool is_word_char(char c) {
+  return isalnum((unsigned char)c) || c == '_';
+}
+
+/**
+ * Поиск совпадения, окруженного границами слова (-w). Как в GNU grep,
+ * неподходящее совпадение сначала укорачивается с того же начала, а
+ * затем поиск продолжается со следующей позиции; выражение при этом не
+ * переписывается и не перекомпилируется
+ * @param matcher Подготовленный шаблон
+ * @param subject Текст из matcher_subject
+ * @param start Начало диапазона
+ * @param end Конец диапазона
+ * @param match Смещения совпадения относительно subject
+ * @return true если совпадение найдено
+ */
+static bool find_whole_word(const Matcher* matcher, const char* subject,
+                            size_t start, size_t end, regmatch_t* match) {
+  while (start <= end && find_any(matcher, subject, start, end, match)) {
+    size_t from = (size_t)match->rm_so;
+    size_t to = (size_t)match->rm_eo;
+    bool word_before = from > 0 && is_word_char(subject[from - 1]);
+
+    while (!word_before) {
+      if (to == end || !is_word_char(subject[to])) {
+        match->rm_eo = (regoff_t)to;
+        return true;
+      }
+      if (matcher->is_literal || to == from) break;
+
+      // Самое длинное совпадение с того же начала, короче прежнего
+      regmatch_t shorter = {(regoff_t)from, (regoff_t)(to - 1)};
+      stats_add(STAT_REGEXEC_CALLS, 1);
+      if (regexec(&matcher->regex, subject, 1, &shorter,
+                  REG_STARTEND | REG_NOTEOL) != 0 ||
+          (size_t)shorter.rm_so != from || shorter.rm_eo == shorter.rm_so) {
+        break;
+      }
+      to = (size_t)shorter.rm_eo;
+    }
+    start = from + 1;
+  }
+  return false;
+}
+
+/**
+ * Поиск первого совпадения в диапазоне [start, end) с учетом -w и -x.
+ * Текст не обязан заканчиваться нулем и может содержать нулевые байты
+ * (REG_STARTEND). Начало subject считается началом строки
+ * @param matcher Подготовленный шаблон
+ * @param subject Текст из matcher_subject
+ * @param start Начало диапазона
+ * @param end Конец диапазона
+ * @param match Смещения совпадения относительно subject
+ * @return true если совпадение найдено
+ */
+bool matcher_find(const Matcher* matcher, const char* subject, size_t start,
+                  size_t end, regmatch_t* match) {
+  if (matcher->scope == SCOPE_LINE) {
+    return find_whole_line(matcher, subject, start, end, match);
+  }
+  if (matcher->scope == SCOPE_WORD) {
+    return find_whole_word(matcher, subject, start, end, match);
+  }
+  return find_any(matcher, subject, start, end, match);
+}
+
+/**
+ * Подсчет строк блока, содержащих совпадение. Поиск идет по всему блоку,
+ * после совпадения продолжается со следующей строки, поэтому строки без
+ * совпадений не выделяются и не просматриваются по отдельности
+ * @param matcher Подготовленный шаблон
+ * @param subject Текст блока из matcher_subject
+ * @param length Длина блока
+ * @return Количество строк с совпадением
+ */
+size_t count_matching_lines(const Matcher* matcher, const char* subject,
+                            size_t length) {
+  size_t count = 0;
+  size_t pos = 0;
+  regmatch_t match;
+
+  while (pos < length && matcher_find(matcher, subject, pos, length, &match)) {
+    size_t at = (size_t)match.rm_so;
+    // Пустое совпадение после завершающего '\n' не относится к строке
+    if (at == length && subject[length - 1] == '\n') break;
+
+    count++;
+    const char* line_end = memchr(subject + at, '\n', length - at);
+    if (line_end == NULL) break;
+    pos = (size_t)(line_end - subject) + 1;
+  }
+  return count;
+}
@@ -0,0 +1,41 @@
+#ifndef SRC_GREP_S21_GREP_MATCHER_H_
+#define SRC_GREP_S21_GREP_MATCHER_H_
+
+#include <regex.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Какая часть строки должна совпасть с шаблоном */
+typedef enum {
+  SCOPE_ANY,   // Любая подстрока
+  SCOPE_WORD,  // Целое слово (-w)
+  SCOPE_LINE   // Вся строка (-x)
+} MatchScope;
+
+/* Поиск шаблона сразу в блоке из многих строк. Регулярное выражение
+ * компилируется с REG_NEWLINE, поэтому '^', '$' и '.' ведут себя так же,
+ * как при построчной обработке; шаблоны без метасимволов ищутся через
+ * memmem без обращения к regexec */
+typedef struct {
+  regex_t regex;
+  MatchScope scope;  // Целое слово или строка (-w, -x)
+  bool fold_case;   // Текст и шаблон сворачиваются в нижний регистр (-i)
+  bool is_literal;  // Шаблон - обычная строка
+  char* literal;
+  size_t literal_length;
+  char* folded;  // Буфер для текста в нижнем регистре
+  size_t folded_capacity;
+} Matcher;
+
+int init_matcher(Matcher* matcher, const char* pattern, bool ignore_case,
+                 MatchScope scope);
+void free_matcher(Matcher* matcher);
+const char* matcher_subject(Matcher* matcher, const char* text,
+                            size_t length);
+void shrink_matcher_subject(Matcher* matcher, size_t limit);
+bool matcher_find(const Matcher* matcher, const char* subject, size_t start,
+                  size_t end, regmatch_t* match);
+size_t count_matching_lines(const Matcher* matcher, const char* subject,
+                            size_t length);
+
+#endif  // SRC_GREP_S21_GREP_MATCHER_H_
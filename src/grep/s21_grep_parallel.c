@@ -0,0 +1,413 @@
+#include "s21_grep_parallel.h"
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "s21_grep.h"
+
+/* Кусок файла, выровненный по границам строк. Куски живут в окне из
+ * window слотов: слот по очереди занимают куски index, index + window,
+ * ..., поэтому буфер найденных строк переиспользуется */
+typedef struct {
+  size_t start;
+  size_t end;
+  size_t line_count;   // Количество строк в куске
+  size_t match_count;  // Количество строк в результате
+  size_t total_lines;  // Для -c -v и --stats: все строки куска
+  MatchList matches;   // Найденные строки (кроме режимов -c и -l)
+  bool stop;           // Для -l: совпадение найдено, дальше искать не нужно
+  bool done;           // Поиск закончен, кусок ждет вывода
+} SearchChunk;
+
+/* Общие данные параллельного поиска по одному файлу. Поток, запустивший
+ * поиск, выводит куски по порядку и освобождает их слоты; рабочий поток
+ * берет следующий кусок, только когда в окне есть свободный слот. Так
+ * память не зависит от числа совпадений, а вывод начинается до конца
+ * поиска. Поля после slots защищены lock */
+typedef struct {
+  const ProgramOptions* options;  // Опции запустившего поиск потока
+  const char* filename;
+  const char* pattern;
+  const char* data;
+  size_t size;
+  int fd;
+  int guard;      // Запись защищенного отображения
+  size_t window;  // Количество слотов
+  SearchChunk* slots;
+  size_t next_start;  // Начало следующего невзятого куска
+  size_t assigned;    // Количество взятых кусков
+  size_t printed;     // Количество выведенных кусков
+  bool exhausted;     // Новых кусков не будет
+  bool failed;        // Ошибка в одном из потоков
+  bool truncated;     // Файл укоротили во время поиска
+  bool output;        // Выведена хотя бы одна строка (только для вывода)
+  pthread_mutex_t lock;
+  pthread_cond_t slot_free;   // Выведен кусок, его слот свободен
+  pthread_cond_t chunk_done;  // Рабочий поток закончил кусок
+} ParallelSearch;
+
+/**
+ * Количество потоков по умолчанию - число доступных процессоров
+ * @return Количество потоков
+ */
+int default_thread_count(void) {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  if (count < 1) count = 1;
+  if (count > PARALLEL_MAX_THREADS) count = PARALLEL_MAX_THREADS;
+  return (int)count;
+}
+
+/**
+ * Конец следующего блока внутри куска: последний '\n' в пределах
+ * READ_BLOCK_SIZE, а для слишком длинной строки - ее конец
+ * @param data Данные файла
+ * @param pos Начало блока
+ * @param end Конец куска
+ * @return Конец блока (не включительно)
+ */
+static size_t next_block_end(const char* data, size_t pos, size_t end) {
+  if (end - pos <= READ_BLOCK_SIZE) return end;
+
+  const char* newline = memrchr(data + pos, '\n', READ_BLOCK_SIZE);
+  if (newline == NULL) newline = memchr(data + pos, '\n', end - pos);
+  return newline ? (size_t)(newline - data) + 1 : end;
+}
+
+/**
+ * Поиск в одном куске файла. Номера строк считаются от начала куска,
+ * результат складывается в chunk->matches
+ * @param parallel Общие данные
+ * @param chunk Кусок файла
+ * @param matcher Шаблон, подготовленный этим потоком
+ * @return false при нехватке памяти
+ */
+static bool search_chunk(const ParallelSearch* parallel, SearchChunk* chunk,
+                         Matcher* matcher) {
+  bool count_mode = options.count_only && !options.files_name_only;
+  FileSearch search = {parallel->filename, 1, 0, false, false,
+                       &chunk->matches, NULL, chunk->start};
+  size_t pos = chunk->start;
+
+  while (pos < chunk->end && !search.stop) {
+    size_t block_end = next_block_end(parallel->data, pos, chunk->end);
+    const char* block = parallel->data + pos;
+    size_t length = block_end - pos;
+    const char* subject = matcher_subject(matcher, block, length);
+    if (subject == NULL) return false;
+
+    if (count_mode) {
+      chunk->match_count += count_matching_lines(matcher, subject, length);
+      if (options.invert_match || stats_enabled) {
+        chunk->total_lines += count_lines(block, length);
+      }
+    } else {
+      search_block(&search, matcher, block, subject, length);
+    }
+    pos = block_end;
+  }
+
+  if (!count_mode) {
+    chunk->match_count = search.match_count;
+    chunk->line_count = search.line_number - 1;
+    chunk->stop = search.stop;
+  }
+  stats_add(STAT_LINES_SCANNED,
+            count_mode ? chunk->total_lines : chunk->line_count);
+  return !chunk->matches.failed;
+}
+
+/**
+ * Взятие следующего куска. Ждет, пока кусок, занимавший его слот,
+ * будет выведен. Конец куска сдвигается к концу строки
+ * @param parallel Общие данные (блокировка захвачена)
+ * @return Взятый кусок или NULL, если кусков больше нет
+ */
+static SearchChunk* claim_chunk(ParallelSearch* parallel) {
+  while (!parallel->exhausted &&
+         parallel->assigned == parallel->printed + parallel->window) {
+    pthread_cond_wait(&parallel->slot_free, &parallel->lock);
+  }
+  if (parallel->exhausted) return NULL;
+
+  size_t start = parallel->next_start;
+  size_t end = parallel->size;
+  if (end - start > PARALLEL_CHUNK_SIZE) {
+    const char* newline = memchr(parallel->data + start + PARALLEL_CHUNK_SIZE,
+                                 '\n', end - start - PARALLEL_CHUNK_SIZE);
+    if (newline != NULL) end = (size_t)(newline - parallel->data) + 1;
+  }
+
+  SearchChunk* chunk = &parallel->slots[parallel->assigned % parallel->window];
+  MatchList matches = chunk->matches;
+  matches.count = 0;
+  *chunk = (SearchChunk){start, end, 0, 0, 0, matches, false, false};
+  parallel->next_start = end;
+  parallel->exhausted = end == parallel->size;
+  parallel->assigned++;
+  return chunk;
+}
+
+/**
+ * Завершение работы с куском: кусок отдается на вывод, а после ошибки
+ * или найденного совпадения (-l) новые куски больше не выдаются
+ * @param parallel Общие данные (блокировка захвачена)
+ * @param chunk Кусок или NULL, если поток не смог начать поиск
+ * @param ok Поиск прошел без ошибок
+ */
+static void finish_chunk(ParallelSearch* parallel, SearchChunk* chunk,
+                         bool ok) {
+  if (chunk != NULL) chunk->done = true;
+  if (!ok) parallel->failed = true;
+  if (!ok || (chunk != NULL && chunk->stop)) {
+    parallel->exhausted = true;
+    pthread_cond_broadcast(&parallel->slot_free);
+  }
+  pthread_cond_broadcast(&parallel->chunk_done);
+}
+
+/**
+ * Поток поиска: у каждого потока свое скомпилированное выражение
+ * (regexec в glibc блокирует общее выражение), куски берутся по порядку
+ * из окна. Опции потоковые, поэтому копируются из запустившего поиск
+ * потока
+ * @param arg Общие данные
+ * @return NULL
+ */
+static void* search_worker(void* arg) {
+  ParallelSearch* parallel = arg;
+  options = *parallel->options;
+
+  Matcher* matcher = acquire_matcher(parallel->pattern,
+                                     options.case_insensitive, match_scope());
+  pthread_mutex_lock(&parallel->lock);
+  if (matcher == NULL) finish_chunk(parallel, NULL, false);
+
+  SearchChunk* chunk;
+  while (matcher != NULL && (chunk = claim_chunk(parallel)) != NULL) {
+    pthread_mutex_unlock(&parallel->lock);
+    bool ok = search_chunk(parallel, chunk, matcher);
+    pthread_mutex_lock(&parallel->lock);
+    finish_chunk(parallel, chunk, ok);
+  }
+  pthread_mutex_unlock(&parallel->lock);
+
+  if (matcher != NULL) release_matcher(matcher);
+  merge_thread_stats();
+  return NULL;
+}
+
+/**
+ * Вывод записи JSON о найденной строке. Границы совпадений ищутся
+ * заново: при поиске строка только запоминалась
+ * @param parallel Общие данные
+ * @param record Найденная строка
+ * @param line_number Номер строки в файле
+ * @param matcher Шаблон или NULL (для -v границ нет)
+ */
+static void print_json_record(const ParallelSearch* parallel,
+                              const MatchRecord* record, size_t line_number,
+                              Matcher* matcher) {
+  const char* subject =
+      matcher ? matcher_subject(matcher, record->text, record->length) : NULL;
+  print_json_match(parallel->filename, line_number, record->offset,
+                   subject ? matcher : NULL, record->text, subject,
+                   record->length);
+}
+
+/**
+ * Вывод найденных строк куска. Номер строки внутри куска переводится в
+ * номер строки файла прибавлением числа строк предыдущих кусков
+ * @param parallel Общие данные
+ * @param chunk Кусок
+ * @param line_base Количество строк в предыдущих кусках
+ * @param matcher Шаблон для --json или NULL
+ */
+static void print_chunk(const ParallelSearch* parallel,
+                        const SearchChunk* chunk, size_t line_base,
+                        Matcher* matcher) {
+  for (size_t m = 0; m < chunk->matches.count; m++) {
+    const MatchRecord* record = &chunk->matches.items[m];
+    size_t line_number = line_base + record->line_number;
+    if (options.json) {
+      print_json_record(parallel, record, line_number, matcher);
+    } else {
+      print_line(parallel->filename, line_number, record->text,
+                 record->length);
+    }
+  }
+}
+
+/**
+ * Освобождение страниц отображения, которые лежат целиком до конца
+ * выведенного куска: они больше не нужны ни одному потоку, и память
+ * процесса не растет с размером файла
+ * @param parallel Общие данные
+ * @param released Граница уже освобожденных страниц (обновляется)
+ * @param end Конец выведенного куска
+ */
+static void release_pages(const ParallelSearch* parallel, size_t* released,
+                          size_t end) {
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  size_t boundary = end - end % page_size;
+  if (boundary > *released) {
+    madvise((char*)parallel->data + *released, boundary - *released,
+            MADV_DONTNEED);
+    *released = boundary;
+  }
+}
+
+/**
+ * Вывод результатов в порядке файла по мере готовности: кусок
+ * выводится, как только закончены он и все предыдущие, после чего его
+ * слот отдается следующему куску
+ * @param parallel Общие данные
+ * @return Количество строк в результате по всему файлу
+ */
+static size_t print_parallel_results(ParallelSearch* parallel) {
+  bool inverted_count = options.invert_match && options.count_only &&
+                        !options.files_name_only;
+  size_t line_base = 0;
+  size_t match_count = 0;
+  size_t released = 0;
+  Matcher* matcher = NULL;
+  if (options.json && !options.invert_match) {
+    matcher = acquire_matcher(parallel->pattern, options.case_insensitive,
+                              match_scope());
+  }
+
+  pthread_mutex_lock(&parallel->lock);
+  while (true) {
+    SearchChunk* chunk = &parallel->slots[parallel->printed % parallel->window];
+    while (parallel->printed < parallel->assigned ? !chunk->done
+                                                  : !parallel->exhausted) {
+      pthread_cond_wait(&parallel->chunk_done, &parallel->lock);
+    }
+    if (parallel->printed == parallel->assigned) break;
+    // Кусок за новым концом файла искался в нулях вместо данных. Размер
+    // файла проверяется один раз, на последнем куске: нули внутри
+    // последней страницы не вызывают SIGBUS
+    if (!parallel->failed &&
+        (guarded_mapping_truncated(parallel->guard) ||
+         (chunk->end == parallel->size &&
+          mapped_file_shrank(parallel->fd, parallel->size)))) {
+      parallel->failed = parallel->truncated = parallel->exhausted = true;
+      pthread_cond_broadcast(&parallel->slot_free);
+    }
+    bool failed = parallel->failed;
+    pthread_mutex_unlock(&parallel->lock);
+
+    if (!failed && chunk->matches.count > 0) {
+      print_chunk(parallel, chunk, line_base, matcher);
+      parallel->output = true;
+    }
+    line_base += chunk->line_count;
+    match_count += inverted_count ? chunk->total_lines - chunk->match_count
+                                  : chunk->match_count;
+    release_pages(parallel, &released, chunk->end);
+
+    pthread_mutex_lock(&parallel->lock);
+    parallel->printed++;
+    pthread_cond_broadcast(&parallel->slot_free);
+  }
+  pthread_mutex_unlock(&parallel->lock);
+
+  if (matcher != NULL) release_matcher(matcher);
+  return match_count;
+}
+
+/**
+ * Параллельный поиск по одному большому файлу. Файл отображается в
+ * память и делится на куски по PARALLEL_CHUNK_SIZE байт по границам
+ * строк. Рабочие потоки ищут в окне из PARALLEL_WINDOW_PER_THREAD
+ * кусков на поток, а этот поток выводит готовые куски в порядке файла.
+ * Для -c и -l строки не запоминаются, складываются только счетчики.
+ * Если файл укоротили, куски за новым концом не выводятся
+ * @param filename Имя файла для вывода
+ * @param pattern Шаблон для поиска
+ * @param file Открытый файл
+ * @return false если файл не подходит (поток, маленький, двоичный) и его
+ *         нужно обработать обычным путем
+ */
+bool search_file_parallel(const char* filename, const char* pattern,
+                          FILE* file) {
+  struct stat file_stat;
+  int fd = fileno(file);
+  if (options.threads < 2 || fd < 0 || fstat(fd, &file_stat) != 0 ||
+      !S_ISREG(file_stat.st_mode) ||
+      (size_t)file_stat.st_size < PARALLEL_MIN_FILE_SIZE) {
+    return false;
+  }
+
+  size_t size = (size_t)file_stat.st_size;
+  int guard;
+  char* data = map_guarded_file(fd, size, &guard);
+  if (data == NULL) return false;
+
+  // Двоичные файлы обрабатываются обычным путем (сообщение, флаг -I)
+  size_t sniff = size < READ_BLOCK_SIZE ? size : READ_BLOCK_SIZE;
+  if (!options.text_mode && is_binary_block(data, sniff)) {
+    unmap_guarded_file(data, size, guard);
+    return false;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  size_t window = (size_t)options.threads * PARALLEL_WINDOW_PER_THREAD;
+  ParallelSearch parallel = {&options,
+                             filename,
+                             pattern,
+                             data,
+                             size,
+                             fd,
+                             guard,
+                             window,
+                             calloc(window, sizeof(SearchChunk)),
+                             0,
+                             0,
+                             0,
+                             false,
+                             false,
+                             false,
+                             false,
+                             PTHREAD_MUTEX_INITIALIZER,
+                             PTHREAD_COND_INITIALIZER,
+                             PTHREAD_COND_INITIALIZER};
+  pthread_t threads[PARALLEL_MAX_THREADS];
+  int started = 0;
+
+  while (parallel.slots != NULL && started < options.threads &&
+         pthread_create(&threads[started], NULL, search_worker, &parallel) ==
+             0) {
+    started++;
+  }
+
+  // До первого вывода можно вернуться к обычному поиску: так
+  // некорректный шаблон получает обычное сообщение об ошибке
+  bool handled = false;
+  if (started > 0) {
+    size_t match_count = print_parallel_results(&parallel);
+    for (int i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    handled = !parallel.failed || parallel.output || parallel.truncated;
+    if (parallel.truncated) {
+      print_truncated_error(filename);
+    } else if (parallel.failed && handled) {
+      print_read_error(filename);
+    }
+    if (!parallel.failed) print_file_summary(filename, match_count);
+  }
+  if (handled) {
+    stats_add(STAT_MAPPED_FILES, 1);
+    stats_add(STAT_BYTES_READ, size);
+    stats_add(STAT_BYTES_MAPPED, size);
+  }
+
+  for (size_t i = 0; parallel.slots != NULL && i < window; i++) {
+    free(parallel.slots[i].matches.items);
+  }
+  free(parallel.slots);
+  pthread_mutex_destroy(&parallel.lock);
+  pthread_cond_destroy(&parallel.slot_free);
+  pthread_cond_destroy(&parallel.chunk_done);
+  unmap_guarded_file(data, size, guard);
+  return handled;
+}
@@ -0,0 +1,16 @@
+#ifndef SRC_GREP_S21_GREP_PARALLEL_H_
+#define SRC_GREP_S21_GREP_PARALLEL_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#define PARALLEL_MIN_FILE_SIZE (32u << 20)
+#define PARALLEL_CHUNK_SIZE (4u << 20)
+#define PARALLEL_WINDOW_PER_THREAD 2  // Кусков в работе на один поток
+#define PARALLEL_MAX_THREADS 256
+
+int default_thread_count(void);
+bool search_file_parallel(const char* filename, const char* pattern,
+                          FILE* file);
+
+#endif  // SRC_GREP_S21_GREP_PARALLEL_H_
@@ -0,0 +1,601 @@
+#include "s21_grep_server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+
+#include "s21_grep.h"
+
+/* Очередь принятых соединений между основным потоком и рабочими */
+typedef struct {
+  int clients[SERVER_QUEUE_SIZE];
+  size_t head;
+  size_t count;
+  bool stopping;  // Новых соединений не будет
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pthread_cond_t not_full;
+} ClientQueue;
+
+/* Принятый запрос: аргументы и дескрипторы клиента */
+typedef struct {
+  int fds[SERVER_FD_COUNT];
+  int argc;
+  char** argv;
+  char* arguments;  // Аргументы, разделенные нулями (на них указывает argv)
+} ClientRequest;
+
+/* Принятые соединения, по которым еще не пришел заголовок. Сроки
+ * добавляются по возрастанию, поэтому ближайший всегда первый */
+typedef struct {
+  int clients[SERVER_PENDING_MAX];
+  int64_t deadlines[SERVER_PENDING_MAX];  // Время закрытия, мс
+  int count;
+} PendingClients;
+
+/* Если поток не смог получить свой рабочий каталог (unshare), запросы
+ * с fchdir выполняются по очереди */
+static pthread_mutex_t shared_cwd_lock = PTHREAD_MUTEX_INITIALIZER;
+static volatile sig_atomic_t server_stopping;
+
+static void handle_stop_signal(int signal_number) {
+  (void)signal_number;
+  server_stopping = 1;
+}
+
+/**
+ * Заполнение адреса сокета
+ * @param address Адрес
+ * @param socket_path Путь к сокету
+ * @return false если путь не помещается в sun_path
+ */
+static bool make_address(struct sockaddr_un* address,
+                         const char* socket_path) {
+  memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  if (strlen(socket_path) >= sizeof(address->sun_path)) return false;
+  strcpy(address->sun_path, socket_path);
+  return true;
+}
+
+/**
+ * Подключение к сокету сервера
+ * @param socket_path Путь к сокету
+ * @return Дескриптор соединения или -1
+ */
+static int connect_to(const char* socket_path) {
+  struct sockaddr_un address;
+  if (!make_address(&address, socket_path)) return -1;
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return -1;
+  if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/**
+ * Чтение ровно length байт
+ * @param fd Дескриптор
+ * @param data Буфер
+ * @param length Количество байт
+ * @return false при ошибке или раннем конце данных
+ */
+static bool read_full(int fd, void* data, size_t length) {
+  char* position = data;
+  while (length > 0) {
+    ssize_t received = read(fd, position, length);
+    if (received < 0 && errno == EINTR) continue;
+    if (received <= 0) return false;
+    position += received;
+    length -= (size_t)received;
+  }
+  return true;
+}
+
+/**
+ * Запись ровно length байт
+ * @param fd Дескриптор
+ * @param data Данные
+ * @param length Количество байт
+ * @return false при ошибке записи
+ */
+static bool write_full(int fd, const void* data, size_t length) {
+  const char* position = data;
+  while (length > 0) {
+    ssize_t sent = write(fd, position, length);
+    if (sent < 0 && errno == EINTR) continue;
+    if (sent <= 0) return false;
+    position += sent;
+    length -= (size_t)sent;
+  }
+  return true;
+}
+
+static void close_fds(int* fds, int count) {
+  for (int i = 0; i < count; i++) {
+    if (fds[i] >= 0) close(fds[i]);
+    fds[i] = -1;
+  }
+}
+
+/**
+ * Получение заголовка запроса вместе с дескрипторами клиента
+ * @param client Соединение
+ * @param header Заголовок
+ * @param fds Дескрипторы (SERVER_FD_COUNT штук)
+ * @return false если заголовок или дескрипторы некорректны
+ */
+static bool receive_header(int client, ServerRequest* header, int* fds) {
+  union {
+    struct cmsghdr align;
+    char data[CMSG_SPACE(sizeof(int) * SERVER_FD_COUNT)];
+  } control;
+  struct iovec part = {header, sizeof(*header)};
+  struct msghdr message = {0};
+  message.msg_iov = &part;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data;
+  message.msg_controllen = sizeof(control.data);
+
+  ssize_t received;
+  do {
+    received = recvmsg(client, &message, MSG_CMSG_CLOEXEC | MSG_WAITALL);
+  } while (received < 0 && errno == EINTR);
+
+  int count = 0;
+  struct cmsghdr* item = CMSG_FIRSTHDR(&message);
+  if (received > 0 && item != NULL && item->cmsg_level == SOL_SOCKET &&
+      item->cmsg_type == SCM_RIGHTS) {
+    count = (int)((item->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+    if (count > SERVER_FD_COUNT) count = SERVER_FD_COUNT;
+    memcpy(fds, CMSG_DATA(item), sizeof(int) * count);
+  }
+
+  if (received != (ssize_t)sizeof(*header) || count != SERVER_FD_COUNT ||
+      (message.msg_flags & (MSG_CTRUNC | MSG_TRUNC)) != 0 ||
+      header->magic != SERVER_MAGIC || header->argc == 0 ||
+      header->argc > SERVER_MAX_ARGS || header->length == 0 ||
+      header->length > SERVER_MAX_REQUEST) {
+    close_fds(fds, count);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Получение запроса: заголовок, дескрипторы и аргументы. Аргументов
+ * должно быть ровно argc, каждый завершается нулем
+ * @param client Соединение
+ * @param request Запрос
+ * @return false если запрос некорректен (дескрипторы уже закрыты)
+ */
+static bool receive_request(int client, ClientRequest* request) {
+  ServerRequest header;
+  for (int i = 0; i < SERVER_FD_COUNT; i++) request->fds[i] = -1;
+  if (!receive_header(client, &header, request->fds)) return false;
+
+  request->argc = (int)header.argc;
+  request->arguments = malloc(header.length);
+  request->argv = calloc(header.argc + 1, sizeof(char*));
+  bool ok = request->arguments != NULL && request->argv != NULL &&
+            read_full(client, request->arguments, header.length) &&
+            request->arguments[header.length - 1] == '\0';
+
+  size_t position = 0;
+  for (int i = 0; ok && i < request->argc; i++) {
+    if (position >= header.length) {
+      ok = false;
+    } else {
+      request->argv[i] = request->arguments + position;
+      position += strlen(request->arguments + position) + 1;
+    }
+  }
+  if (!ok || position != header.length) {
+    close_fds(request->fds, SERVER_FD_COUNT);
+    free(request->arguments);
+    free(request->argv);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Выполнение одного запроса в каталоге клиента с его stdout и stderr.
+ * Дескрипторы клиента закрываются до ответа, чтобы читатель его вывода
+ * увидел конец данных одновременно с завершением клиента
+ * @param client Соединение
+ * @param private_cwd У потока свой рабочий каталог
+ */
+static void serve_client(int client, bool private_cwd) {
+  ClientRequest request;
+  if (!receive_request(client, &request)) return;
+
+  int32_t code = GREP_EXIT_ERROR;
+  if (!private_cwd) pthread_mutex_lock(&shared_cwd_lock);
+  if (fchdir(request.fds[0]) == 0) {
+    FILE* errors = fdopen(request.fds[2], "w");
+    if (errors != NULL) {
+      request.fds[2] = -1;
+      code = run_grep(request.argc, request.argv, request.fds[1], errors,
+                      true);
+      fclose(errors);
+    }
+  }
+  if (!private_cwd) pthread_mutex_unlock(&shared_cwd_lock);
+
+  close_fds(request.fds, SERVER_FD_COUNT);
+  free(request.arguments);
+  free(request.argv);
+  write_full(client, &code, sizeof(code));
+}
+
+/**
+ * Следующее соединение из очереди
+ * @param queue Очередь
+ * @return Соединение или -1, если сервер остановлен и очередь пуста
+ */
+static int pop_client(ClientQueue* queue) {
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == 0 && !queue->stopping) {
+    pthread_cond_wait(&queue->not_empty, &queue->lock);
+  }
+  int client = -1;
+  if (queue->count > 0) {
+    client = queue->clients[queue->head];
+    queue->head = (queue->head + 1) % SERVER_QUEUE_SIZE;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+  }
+  pthread_mutex_unlock(&queue->lock);
+  return client;
+}
+
+/**
+ * Добавление соединения в очередь. Если очередь заполнена, основной
+ * поток ждет, а новые клиенты ждут в очереди listen
+ * @param queue Очередь
+ * @param client Соединение
+ */
+static void push_client(ClientQueue* queue, int client) {
+  pthread_mutex_lock(&queue->lock);
+  while (queue->count == SERVER_QUEUE_SIZE) {
+    pthread_cond_wait(&queue->not_full, &queue->lock);
+  }
+  queue->clients[(queue->head + queue->count) % SERVER_QUEUE_SIZE] = client;
+  queue->count++;
+  pthread_cond_signal(&queue->not_empty);
+  pthread_mutex_unlock(&queue->lock);
+}
+
+/**
+ * Рабочий поток сервера. Поток отделяет свой рабочий каталог
+ * (unshare(CLONE_FS)), чтобы fchdir в каталог клиента не влиял на
+ * остальные запросы
+ * @param arg Очередь соединений
+ * @return NULL
+ */
+static void* server_worker(void* arg) {
+  ClientQueue* queue = arg;
+  bool private_cwd = unshare(CLONE_FS) == 0;
+  struct timeval timeout = {SERVER_RECEIVE_TIMEOUT, 0};
+
+  int client;
+  while ((client = pop_client(queue)) >= 0) {
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    serve_client(client, private_cwd);
+    close(client);
+  }
+  merge_thread_stats();
+  return NULL;
+}
+
+/**
+ * Создание слушающего сокета. Старый файл сокета удаляется, только если
+ * это действительно сокет и к нему никто не подключен
+ * @param socket_path Путь к сокету
+ * @return Дескриптор или -1 (сообщение уже выведено)
+ */
+static int open_listener(const char* socket_path) {
+  struct sockaddr_un address;
+  if (!make_address(&address, socket_path)) {
+    fprintf(stderr, "Ошибка: Слишком длинный путь к сокету %s\n",
+            socket_path);
+    return -1;
+  }
+
+  struct stat file_stat;
+  if (lstat(socket_path, &file_stat) == 0) {
+    int running = connect_to(socket_path);
+    if (running >= 0 || !S_ISSOCK(file_stat.st_mode)) {
+      if (running >= 0) close(running);
+      fprintf(stderr, "Ошибка: Путь %s уже занят\n", socket_path);
+      return -1;
+    }
+    unlink(socket_path);
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd >= 0 &&
+      (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+       listen(fd, SERVER_BACKLOG) != 0)) {
+    close(fd);
+    fd = -1;
+  }
+  if (fd < 0) {
+    fprintf(stderr, "Ошибка: Не удалось создать сокет %s\n", socket_path);
+  }
+  return fd;
+}
+
+/**
+ * Проверка, что клиент запущен тем же пользователем, что и сервер.
+ * Сокет доступен всем, кто может открыть его путь, а клиент передает
+ * серверу свои дескрипторы и рабочий каталог: чужой клиент читал бы
+ * файлы с правами сервера
+ * @param client Принятое соединение
+ * @return true если пользователь совпадает
+ */
+static bool is_same_user(int client) {
+  struct ucred credentials;
+  socklen_t length = sizeof(credentials);
+  return getsockopt(client, SOL_SOCKET, SO_PEERCRED, &credentials,
+                    &length) == 0 &&
+         credentials.uid == geteuid();
+}
+
+/**
+ * Текущее время для сроков ожидания
+ * @return Миллисекунды монотонных часов
+ */
+static int64_t monotonic_ms(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * Передача рабочим потокам соединений, по которым пришли данные (или
+ * которые закрыл клиент), и закрытие соединений с истекшим сроком
+ * @param pending Ожидающие соединения
+ * @param polled Результат ppoll для них (в том же порядке)
+ * @param queue Очередь соединений
+ * @param now Текущее время, мс
+ */
+static void dispatch_pending(PendingClients* pending,
+                             const struct pollfd* polled, ClientQueue* queue,
+                             int64_t now) {
+  int kept = 0;
+  for (int i = 0; i < pending->count; i++) {
+    int client = pending->clients[i];
+    if (polled[i].revents != 0) {
+      push_client(queue, client);
+    } else if (pending->deadlines[i] <= now) {
+      close(client);
+    } else {
+      pending->clients[kept] = client;
+      pending->deadlines[kept] = pending->deadlines[i];
+      kept++;
+    }
+  }
+  pending->count = kept;
+}
+
+/**
+ * Прием соединений до SIGINT или SIGTERM. Сигналы заблокированы везде,
+ * кроме ожидания в ppoll, поэтому остановка не теряется между проверкой
+ * флага и ожиданием. Соединения других пользователей закрываются сразу.
+ * Рабочему потоку соединение передается, только когда по нему пришли
+ * данные; соединение без заголовка дольше SERVER_HEADER_TIMEOUT_MS
+ * закрывается, поэтому молчащие клиенты не занимают рабочие потоки.
+ * Пока ожидающих соединений SERVER_PENDING_MAX, новые ждут в очереди
+ * listen
+ * @param listener Слушающий сокет
+ * @param queue Очередь соединений
+ * @param wait_mask Маска сигналов на время ожидания
+ */
+static void accept_clients(int listener, ClientQueue* queue,
+                           const sigset_t* wait_mask) {
+  PendingClients pending = {.count = 0};
+  struct pollfd waiting[SERVER_PENDING_MAX + 1];
+
+  while (!server_stopping) {
+    int64_t now = monotonic_ms();
+    waiting[0] = (struct pollfd){
+        listener, pending.count < SERVER_PENDING_MAX ? POLLIN : 0, 0};
+    for (int i = 0; i < pending.count; i++) {
+      waiting[i + 1] = (struct pollfd){pending.clients[i], POLLIN, 0};
+    }
+    struct timespec timeout = {0, 0};
+    if (pending.count > 0 && pending.deadlines[0] > now) {
+      int64_t left = pending.deadlines[0] - now;
+      timeout = (struct timespec){left / 1000, left % 1000 * 1000000};
+    }
+
+    if (ppoll(waiting, (nfds_t)pending.count + 1,
+              pending.count > 0 ? &timeout : NULL, wait_mask) < 0) {
+      if (errno == EINTR) continue;
+      fprintf(stderr, "Ошибка: Не удалось дождаться соединения\n");
+      break;
+    }
+    now = monotonic_ms();
+    dispatch_pending(&pending, waiting + 1, queue, now);
+
+    if ((waiting[0].revents & POLLIN) == 0) continue;
+    int client = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+    if (client >= 0 && !is_same_user(client)) {
+      close(client);
+    } else if (client >= 0) {
+      pending.clients[pending.count] = client;
+      pending.deadlines[pending.count] = now + SERVER_HEADER_TIMEOUT_MS;
+      pending.count++;
+    }
+  }
+  for (int i = 0; i < pending.count; i++) close(pending.clients[i]);
+}
+
+/**
+ * Режим сервера (--serve): запросы клиентов выполняются потоками одного
+ * процесса, скомпилированные шаблоны переиспользуются между запросами.
+ * Сервер работает до SIGINT или SIGTERM
+ * @param socket_path Путь к сокету
+ * @return Код завершения
+ */
+int run_server(const char* socket_path) {
+  int listener = open_listener(socket_path);
+  if (listener < 0) return GREP_EXIT_ERROR;
+
+  // Клиент может закрыть вывод раньше времени: это ошибка записи запроса,
+  // а не завершение сервера
+  signal(SIGPIPE, SIG_IGN);
+  struct sigaction stop_action = {0};
+  stop_action.sa_handler = handle_stop_signal;
+  sigaction(SIGINT, &stop_action, NULL);
+  sigaction(SIGTERM, &stop_action, NULL);
+
+  sigset_t stop_signals;
+  sigset_t wait_mask;
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGINT);
+  sigaddset(&stop_signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &stop_signals, &wait_mask);
+  sigdelset(&wait_mask, SIGINT);
+  sigdelset(&wait_mask, SIGTERM);
+
+  ClientQueue queue = {.head = 0, .count = 0, .stopping = false};
+  pthread_mutex_init(&queue.lock, NULL);
+  pthread_cond_init(&queue.not_empty, NULL);
+  pthread_cond_init(&queue.not_full, NULL);
+
+  pthread_t workers[PARALLEL_MAX_THREADS];
+  int started = 0;
+  while (started < options.threads &&
+         pthread_create(&workers[started], NULL, server_worker, &queue) ==
+             0) {
+    started++;
+  }
+
+  if (started > 0) {
+    accept_clients(listener, &queue, &wait_mask);
+  } else {
+    fprintf(stderr, "Ошибка: Не удалось запустить потоки сервера\n");
+  }
+
+  pthread_mutex_lock(&queue.lock);
+  queue.stopping = true;
+  pthread_cond_broadcast(&queue.not_empty);
+  pthread_mutex_unlock(&queue.lock);
+  for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+
+  close(listener);
+  unlink(socket_path);
+  pthread_cond_destroy(&queue.not_full);
+  pthread_cond_destroy(&queue.not_empty);
+  pthread_mutex_destroy(&queue.lock);
+  print_stats("s21_grep --serve");
+  return started > 0 ? GREP_EXIT_MATCH : GREP_EXIT_ERROR;
+}
+
+/**
+ * Отправка заголовка запроса вместе с дескрипторами
+ * @param server Соединение
+ * @param header Заголовок
+ * @param fds Рабочий каталог, stdout и stderr клиента
+ * @return false при ошибке отправки
+ */
+static bool send_header(int server, const ServerRequest* header,
+                        const int* fds) {
+  union {
+    struct cmsghdr align;
+    char data[CMSG_SPACE(sizeof(int) * SERVER_FD_COUNT)];
+  } control;
+  struct iovec part = {(void*)header, sizeof(*header)};
+  struct msghdr message = {0};
+  message.msg_iov = &part;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data;
+  message.msg_controllen = sizeof(control.data);
+
+  struct cmsghdr* item = CMSG_FIRSTHDR(&message);
+  item->cmsg_level = SOL_SOCKET;
+  item->cmsg_type = SCM_RIGHTS;
+  item->cmsg_len = CMSG_LEN(sizeof(int) * SERVER_FD_COUNT);
+  memcpy(CMSG_DATA(item), fds, sizeof(int) * SERVER_FD_COUNT);
+
+  ssize_t sent;
+  do {
+    sent = sendmsg(server, &message, MSG_NOSIGNAL);
+  } while (sent < 0 && errno == EINTR);
+  return sent == (ssize_t)sizeof(*header);
+}
+
+/**
+ * Отправка запроса серверу: рабочий каталог, stdout и stderr передаются
+ * дескрипторами, поэтому сервер пишет результат прямо в вывод клиента
+ * @param server Соединение
+ * @param argc Количество аргументов
+ * @param argv Аргументы
+ * @return false если запрос не удалось отправить
+ */
+static bool send_request(int server, int argc, char** argv) {
+  size_t length = 0;
+  for (int i = 0; i < argc; i++) length += strlen(argv[i]) + 1;
+  if (argc > SERVER_MAX_ARGS || length > SERVER_MAX_REQUEST) return false;
+
+  char* arguments = malloc(length);
+  int cwd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC);
+  bool ok = arguments != NULL && cwd >= 0;
+  if (ok) {
+    size_t position = 0;
+    for (int i = 0; i < argc; i++) {
+      size_t size = strlen(argv[i]) + 1;
+      memcpy(arguments + position, argv[i], size);
+      position += size;
+    }
+    ServerRequest header = {SERVER_MAGIC, (uint32_t)argc, (uint32_t)length};
+    int fds[SERVER_FD_COUNT] = {cwd, STDOUT_FILENO, STDERR_FILENO};
+    ok = send_header(server, &header, fds) &&
+         write_full(server, arguments, length);
+  }
+  if (cwd >= 0) close(cwd);
+  free(arguments);
+  return ok;
+}
+
+/**
+ * Выполнение запуска на сервере (переменная S21_GREP_SOCKET). Запросы
+ * --serve и --build-index (и их сокращения, которые принимает
+ * getopt_long) всегда выполняются локально (has_local_only_option)
+ * @param socket_path Путь к сокету сервера
+ * @param argc Количество аргументов
+ * @param argv Аргументы
+ * @return Код завершения или -1, если сервер недоступен и поиск нужно
+ *         выполнить в этом процессе
+ */
+int forward_to_server(const char* socket_path, int argc, char** argv) {
+  if (has_local_only_option(argc, argv)) return -1;
+
+  int server = connect_to(socket_path);
+  if (server < 0) return -1;
+  if (!send_request(server, argc, argv)) {
+    close(server);
+    return -1;
+  }
+
+  int32_t code;
+  bool replied = read_full(server, &code, sizeof(code));
+  close(server);
+  if (!replied) {
+    fprintf(stderr, "Ошибка: Сервер %s не ответил\n", socket_path);
+    return GREP_EXIT_ERROR;
+  }
+  return code;
+}
@@ -0,0 +1,29 @@
+#ifndef SRC_GREP_S21_GREP_SERVER_H_
+#define SRC_GREP_S21_GREP_SERVER_H_
+
+#include <stdint.h>
+
+#define SERVER_SOCKET_ENV "S21_GREP_SOCKET"
+#define SERVER_MAGIC 0x73323167u  // "s21g"
+#define SERVER_BACKLOG 64
+#define SERVER_QUEUE_SIZE 256
+#define SERVER_MAX_ARGS 4096
+#define SERVER_MAX_REQUEST (1u << 20)
+#define SERVER_RECEIVE_TIMEOUT 5      // Секунд на получение запроса
+#define SERVER_HEADER_TIMEOUT_MS 250  // Ожидание первых данных после accept
+#define SERVER_PENDING_MAX 64         // Соединения, ожидающие заголовка
+#define SERVER_FD_COUNT 3             // Рабочий каталог, stdout, stderr
+
+/* Заголовок запроса. Вместе с ним через SCM_RIGHTS передаются
+ * дескрипторы клиента, следом идут аргументы, разделенные нулями.
+ * Ответ сервера - код завершения (int32_t) */
+typedef struct {
+  uint32_t magic;
+  uint32_t argc;
+  uint32_t length;  // Размер аргументов в байтах
+} ServerRequest;
+
+int run_server(const char* socket_path);
+int forward_to_server(const char* socket_path, int argc, char** argv);
+
+#endif  // SRC_GREP_S21_GREP_SERVER_H_
@@ -1,20 +1,226 @@
+#include <signal.h>
+#include <spawn.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
+#include "s21_bench.h"
+#include "s21_grep_index.h"
+#include "s21_grep_server.h"
+#include "s21_test.h"
+
 // Конфигурация тестирования
-#define MAX_FLAGS 8
-#define BUFFER_SIZE 8192
-#define TEST_FILES " 1.txt 2.txt 3.txt 4.txt 5.txt"
-#define TEST "\"test\""
-#define TEST_E "-e \"TEST\" -e \"line\""
+#define MAX_FLAGS 10
+#define BUFFER_SIZE 256
+#define TEST_FILE_COUNT 5
+#define TEST "test"
+#define TEST_E "-e TEST -e line"
 #define TEST_F "-f patterns.txt"
+// GNU grep 3.8 с -o -w -x выводит лишнюю пустую строку, такие
+// комбинации не сравниваются
+#define OWX_MASK (1 << 7 | 1 << 8 | 1 << 9)
+#define FIXTURE_DIR "fixtures"
+#define GZIP_TRUNCATED_SIZE 21  // Без конца потока и контрольной суммы
+#define SERVE_SOCKET FIXTURE_DIR "/serve.sock"
+#define SERVE_CLIENT SERVER_SOCKET_ENV "=" SERVE_SOCKET " ./s21_grep "
+#define SERVE_WAIT_STEPS 500  // Ожидание запуска сервера по 10 мс
+#define FIXED_CASE(arguments, output, code) \
+  { arguments, output, sizeof(output) - 1, "", code }
+#define FIXED_ERROR_CASE(arguments, output, errors, code) \
+  { arguments, output, sizeof(output) - 1, errors, code }
+
+// Проверка режима, которого нет в GNU grep: аргументы вместе с файлами,
+// ожидаемый вывод (может содержать нулевые байты) и stderr
+typedef struct {
+  const char *arguments;
+  const char *output;
+  size_t length;
+  const char *errors;
+  int code;
+} FixedCase;
 
 // Тестируемые флаги grep
-const char *flags[] = {"-i", "-v", "-c", "-l", "-n", "-h", "-s", "-o"};
+const char *flags[] = {"-i", "-v", "-c", "-l", "-n",
+                       "-h", "-s", "-o", "-w", "-x"};
 const char *patterns[] = {"test", "TEST", "line", "pattern", "[a-z]"};
+// Флаги вывода с -Z (после имени файла выводится нулевой байт)
+const char *null_flags[] = {"-Z",    "-Z -n", "-Z -c",   "-Z -l",
+                            "-Z -o", "-Z -h", "--null -c -v"};
+// Скобочные выражения с -i: диапазоны и классы не должны терять
+// символы между 'Z' и 'a' при свертывании регистра
+const char *bracket_cases[] = {
+    "-i [A-z]",  "-i -c [A-z]",    "-i -v [A-z]",         "-i [_-z]",
+    "-i [^a-z]", "-i [[:upper:]]", "-i -n [[:alpha:]_]", "-i [Q-]"};
+char *bracket_file[] = {FIXTURE_DIR "/brackets.txt"};
+char *test_files[TEST_FILE_COUNT] = {"1.txt", "2.txt", "3.txt", "4.txt",
+                                     "5.txt"};
+
+// Проверки на больших сгенерированных наборах (--large)
+const BenchCase large_cases[] = {
+    {"", "ERROR", CORPUS_HUGE},
+    {"-n", "FATAL", CORPUS_HUGE},
+    {"-c -v", "INFO", CORPUS_HUGE},
+    {"-i -n", "fatal", CORPUS_HUGE},
+    {"-o -n", "[0-9][0-9]*ms", CORPUS_HUGE},
+    {"-l", "FATAL", CORPUS_HUGE},
+    {"-c", "FATAL", CORPUS_SMALL_FILES},
+    {"-h -n", "ERROR", CORPUS_SMALL_FILES},
+    {"-n", "needle", CORPUS_LONG_LINES},
+    {"-o", "needle", CORPUS_LONG_LINES},
+    {"-c", "ERROR", CORPUS_BINARY},
+    {"", "ERROR", CORPUS_BINARY},
+};
+
+// gzip -n для "alpha\nbeta\n" и "gamma beta\n"
+const char gzip_first[] =
+    "\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\x03\x4b\xcc\x29\xc8\x48\xe4"
+    "\x4a\x4a\x2d\x49\xe4\x02\x00\x6e\x50\x30\x6e\x0b\x00\x00\x00";
+const char gzip_second[] =
+    "\x1f\x8b\x08\x00\x00\x00\x00\x00\x00\x03\x4b\x4f\xcc\xcd\x4d\x54"
+    "\x48\x4a\x2d\x49\xe4\x02\x00\x8f\x9c\x23\xc0\x0b\x00\x00\x00";
+
+const char binary_fixture[] = "text match\n\0bin match\nother\n";
+
+// Индекс (--index): fresh.txt не менялся после построения индекса,
+// stale.txt изменился, new.txt в индекс не попал. В каталогах broken и
+// truncated индекс поврежден, и поиск идет по всем файлам
+const FixedCase fixed_cases[] = {
+    FIXED_CASE("--index fixtures/index beta",
+               "fixtures/index/fresh.txt:alpha beta\n"
+               "fixtures/index/new.txt:beta new\n"
+               "fixtures/index/other.txt:epsilon beta\n"
+               "fixtures/index/stale.txt:beta stale\n",
+               0),
+    FIXED_CASE("--index fixtures/index -c gamma",
+               "fixtures/index/fresh.txt:1\n"
+               "fixtures/index/new.txt:0\n"
+               "fixtures/index/other.txt:0\n"
+               "fixtures/index/stale.txt:0\n",
+               0),
+    FIXED_CASE("--index fixtures/index -l delta|zeta",
+               "fixtures/index/other.txt\n", 0),
+    FIXED_CASE("--index fixtures/index -h nothing", "", 1),
+    FIXED_CASE("--index fixtures/broken -h beta",
+               "alpha beta\nepsilon beta\n", 0),
+    FIXED_CASE("--index fixtures/truncated -h beta",
+               "alpha beta\nepsilon beta\n", 0),
+    FIXED_ERROR_CASE("--index fixtures/missing beta", "",
+                     "Ошибка: Не удалось прочитать каталог fixtures/missing\n",
+                     2),
+    FIXED_ERROR_CASE("--build-index fixtures/missing", "",
+                     "Ошибка: Не удалось прочитать каталог fixtures/missing\n",
+                     2),
+    // Распаковка (-z): склеенные gzip-члены читаются подряд, обычный файл
+    // читается как есть, обрезанный дает выведенную часть и код 2
+    FIXED_CASE("-z beta fixtures/concat.gz", "beta\ngamma beta\n", 0),
+    FIXED_CASE("-z -c beta fixtures/plain.txt fixtures/concat.gz",
+               "fixtures/plain.txt:1\nfixtures/concat.gz:2\n", 0),
+    FIXED_CASE("-z -n alpha fixtures/plain.txt", "1:alpha\n", 0),
+    FIXED_ERROR_CASE("-z beta fixtures/truncated.gz", "beta\n",
+                     "Ошибка: Не удалось прочитать файл "
+                     "fixtures/truncated.gz\n",
+                     2),
+    FIXED_CASE("-z -s beta fixtures/truncated.gz", "beta\n", 2),
+    FIXED_CASE("-c beta fixtures/concat.gz", "0\n", 1),
+    // Двоичные файлы: без -a выводится только сообщение, -I пропускает
+    // файл, -c и -l считают строки как обычно
+    FIXED_CASE("match fixtures/binary.dat",
+               "Binary file fixtures/binary.dat matches\n", 0),
+    FIXED_CASE("-v other fixtures/binary.dat",
+               "Binary file fixtures/binary.dat matches\n", 0),
+    FIXED_CASE("nothing fixtures/binary.dat", "", 1),
+    FIXED_CASE("-a -n match fixtures/binary.dat",
+               "1:text match\n2:\0bin match\n", 0),
+    FIXED_CASE("-a -o bin fixtures/binary.dat", "bin\n", 0),
+    FIXED_CASE("-c match fixtures/binary.dat", "2\n", 0),
+    FIXED_CASE("-l match fixtures/binary.dat", "fixtures/binary.dat\n", 0),
+    FIXED_CASE("-I match fixtures/binary.dat", "", 1),
+    FIXED_CASE("-I -l match fixtures/binary.dat", "", 1),
+    FIXED_CASE("-I -c match fixtures/binary.dat fixtures/plain.txt",
+               "fixtures/binary.dat:0\nfixtures/plain.txt:0\n", 1),
+    FIXED_CASE("-I -v other fixtures/binary.dat fixtures/plain.txt",
+               "fixtures/plain.txt:alpha\nfixtures/plain.txt:beta\n", 0),
+    // JSON (--json): имя файла в записях меняется вместе с файлом, пустые
+    // совпадения x* не прерывают поиск следующих, текст экранируется
+    FIXED_CASE("--json beta fixtures/plain.txt fixtures/index/new.txt",
+               "{\"type\":\"match\",\"file\":\"fixtures/plain.txt\","
+               "\"line\":2,\"offset\":6,\"submatches\":[[0,4]],"
+               "\"text\":\"beta\"}\n"
+               "{\"type\":\"match\",\"file\":\"fixtures/index/new.txt\","
+               "\"line\":1,\"offset\":0,\"submatches\":[[0,4]],"
+               "\"text\":\"beta new\"}\n",
+               0),
+    FIXED_CASE("--json x* fixtures/json.txt",
+               "{\"type\":\"match\",\"file\":\"fixtures/json.txt\","
+               "\"line\":1,\"offset\":0,\"submatches\":[[2,4],[5,6]],"
+               "\"text\":\"abxxcx\"}\n"
+               "{\"type\":\"match\",\"file\":\"fixtures/json.txt\","
+               "\"line\":2,\"offset\":7,\"submatches\":[],"
+               "\"text\":\"\\\"q\\\"\\\\\\ttab\"}\n"
+               "{\"type\":\"match\",\"file\":\"fixtures/json.txt\","
+               "\"line\":3,\"offset\":16,\"submatches\":[],"
+               "\"text\":\"none\"}\n",
+               0),
+    FIXED_CASE("--json -i Q fixtures/json.txt",
+               "{\"type\":\"match\",\"file\":\"fixtures/json.txt\","
+               "\"line\":2,\"offset\":7,\"submatches\":[[1,2]],"
+               "\"text\":\"\\\"q\\\"\\\\\\ttab\"}\n",
+               0),
+    FIXED_CASE("--json -v alpha fixtures/plain.txt",
+               "{\"type\":\"match\",\"file\":\"fixtures/plain.txt\","
+               "\"line\":2,\"offset\":6,\"submatches\":[],"
+               "\"text\":\"beta\"}\n",
+               0),
+    FIXED_CASE("--json -c beta fixtures/plain.txt fixtures/index/new.txt",
+               "{\"type\":\"count\",\"file\":\"fixtures/plain.txt\","
+               "\"count\":1}\n"
+               "{\"type\":\"count\",\"file\":\"fixtures/index/new.txt\","
+               "\"count\":1}\n",
+               0),
+    FIXED_CASE("--json -l match fixtures/plain.txt fixtures/binary.dat",
+               "{\"type\":\"file\",\"file\":\"fixtures/binary.dat\"}\n", 0),
+    FIXED_CASE("--json match fixtures/binary.dat",
+               "{\"type\":\"binary\",\"file\":\"fixtures/binary.dat\"}\n",
+               0),
+    FIXED_CASE("-o x* fixtures/json.txt", "xx\nx\n", 0),
+    // -Z: после имени файла нулевой байт вместо ':' и '\n'
+    FIXED_CASE("-Z -l beta fixtures/plain.txt fixtures/index/new.txt",
+               "fixtures/plain.txt\0fixtures/index/new.txt\0", 0),
+    FIXED_CASE("-Z -c beta fixtures/plain.txt fixtures/index/new.txt",
+               "fixtures/plain.txt\0001\nfixtures/index/new.txt\0001\n", 0),
+    FIXED_CASE("-Z -n beta fixtures/plain.txt fixtures/index/new.txt",
+               "fixtures/plain.txt\0002:beta\n"
+               "fixtures/index/new.txt\0001:beta new\n",
+               0),
+};
+
+// Запросы к серверу (--serve) через env: сервер читает файлы из рабочего
+// каталога клиента и пишет в его дескрипторы. Второй сервер на том же
+// сокете не запускается, пока первый работает; без сервера поиск идет
+// в самом клиенте
+const FixedCase serve_cases[] = {
+    FIXED_CASE(SERVE_CLIENT "-n beta fixtures/plain.txt", "2:beta\n", 0),
+    FIXED_CASE(SERVE_CLIENT "-c -i A fixtures/plain.txt fixtures/index/new.txt",
+               "fixtures/plain.txt:2\nfixtures/index/new.txt:1\n", 0),
+    FIXED_CASE(SERVE_CLIENT "-l match fixtures/plain.txt fixtures/binary.dat",
+               "fixtures/binary.dat\n", 0),
+    FIXED_CASE(SERVE_CLIENT "nothing fixtures/plain.txt", "", 1),
+    FIXED_CASE(SERVE_CLIENT "-e --build-index fixtures/plain.txt", "", 1),
+    FIXED_ERROR_CASE(SERVE_CLIENT "beta fixtures/missing.txt", "",
+                     "Ошибка: Не удалось открыть файл fixtures/missing.txt\n",
+                     2),
+    FIXED_ERROR_CASE(SERVE_CLIENT "--serve " SERVE_SOCKET, "",
+                     "Ошибка: Путь " SERVE_SOCKET " уже занят\n", 2),
+    FIXED_CASE(SERVER_SOCKET_ENV "=" FIXTURE_DIR
+               "/missing.sock ./s21_grep -c beta fixtures/plain.txt",
+               "1\n", 0),
+};
 
 /**
  * Создает тестовые файлы и файл с шаблонами для флага -f
@@ -28,7 +234,7 @@ const char *patterns[] = {"test", "TEST", "line", "pattern", "[a-z]"};
 void create_test_files() {
   // Создаем основные тестовые файлы
   FILE *f = fopen("1.txt", "w");
-  fprintf(f, "test line 1\nline 2\nTEST line 3\ntest line 4\n");
+  fprintf(f, "test line 1\nline 2\nTEST line 3\ntest line 4\ntest\n");
   fclose(f);
 
   f = fopen("2.txt", "w");
@@ -55,99 +261,322 @@ void create_test_files() {
 }
 
 /**
- * Выполняет команду и возвращает ее вывод
- * @param cmd Команда для выполнения
- * @return Указатель на статический буфер с выводом
+ * Записывает файл для проверок с заранее известным результатом
+ * @param path Путь к файлу
+ * @param data Содержимое (может содержать нулевые байты)
+ * @param length Длина содержимого
+ * @return false при ошибке записи
  */
-char *run_cmd(const char *cmd) {
-  static char output[BUFFER_SIZE];
-  FILE *fp = popen(cmd, "r");
+bool write_binary_fixture(const char *path, const char *data,
+                          size_t length) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL) return false;
+  bool ok = fwrite(data, 1, length, f) == length;
+  return fclose(f) == 0 && ok;
+}
 
-  output[0] = '\0';
-  if (!fp) return "CMD ERROR";
+/**
+ * Записывает текстовый файл для проверок с заранее известным результатом
+ * @param path Путь к файлу
+ * @param text Содержимое
+ * @return false при ошибке записи
+ */
+bool write_fixture(const char *path, const char *text) {
+  return write_binary_fixture(path, text, strlen(text));
+}
 
-  char buf[256];
-  while (fgets(buf, sizeof(buf), fp)) strcat(output, buf);
+/**
+ * Создает файлы для -z: обычный, сжатый из двух склеенных gzip-членов
+ * и обрезанный посреди первого члена
+ * @return false при ошибке записи
+ */
+bool create_gzip_fixtures(void) {
+  char concat[sizeof(gzip_first) + sizeof(gzip_second) - 2];
+  memcpy(concat, gzip_first, sizeof(gzip_first) - 1);
+  memcpy(concat + sizeof(gzip_first) - 1, gzip_second,
+         sizeof(gzip_second) - 1);
+  return write_fixture(FIXTURE_DIR "/plain.txt", "alpha\nbeta\n") &&
+         write_binary_fixture(FIXTURE_DIR "/concat.gz", concat,
+                              sizeof(concat)) &&
+         write_binary_fixture(FIXTURE_DIR "/truncated.gz", gzip_first,
+                              GZIP_TRUNCATED_SIZE);
+}
 
-  pclose(fp);
-  return output;
+/**
+ * Создает каталог с файлами и строит в нем индекс
+ * @param dir Каталог
+ * @return false при ошибке
+ */
+bool create_index_directory(const char *dir) {
+  char path[BUFFER_SIZE];
+  mkdir(dir, 0755);
+  snprintf(path, sizeof(path), "%s/fresh.txt", dir);
+  bool ok = write_fixture(path, "alpha beta\ngamma\n");
+  snprintf(path, sizeof(path), "%s/other.txt", dir);
+  ok = ok && write_fixture(path, "delta\nepsilon beta\n");
+  snprintf(path, sizeof(path), "./s21_grep --build-index %s", dir);
+  return ok && system(path) == 0;
 }
 
 /**
- * Формирует команду grep с указанными параметрами
- * @param dest Буфер для команды
- * @param prefix "grep" или "./s21_grep"
- * @param flags_str Строка с флагами
- * @param pattern Шаблон для поиска (NULL для -f)
- * @param use_f Флаг использования -f вместо прямого шаблона
- * @param use_e Флаг использования -e для шаблона
+ * Повреждает индекс каталога: ссылки всех триграмм на списки файлов
+ * выходят за конец файла
+ * @param dir Каталог с индексом
+ * @return false при ошибке
  */
-void build_grep_cmd(char *dest, const char *prefix, const char *flags_str,
-                    int i) {
-  char pattern_part[256] = "";
+bool break_index(const char *dir) {
+  char path[BUFFER_SIZE];
+  snprintf(path, sizeof(path), "%s/%s", dir, INDEX_FILE_NAME);
+  FILE *f = fopen(path, "r+b");
+  if (f == NULL) return false;
 
-  if (i == 0) {
-    snprintf(pattern_part, sizeof(pattern_part), "%s", TEST);
-  } else if (i == 1) {
-    snprintf(pattern_part, sizeof(pattern_part), "%s", TEST_F);
-  } else {
-    snprintf(pattern_part, sizeof(pattern_part), "%s", TEST_E);
+  IndexHeader header;
+  bool ok = fread(&header, sizeof(header), 1, f) == 1;
+  for (uint32_t i = 0; ok && i < header.trigram_count; i++) {
+    IndexTrigramEntry entry;
+    long offset = (long)(header.trigrams_offset + i * sizeof(entry));
+    ok = fseek(f, offset, SEEK_SET) == 0 &&
+         fread(&entry, sizeof(entry), 1, f) == 1;
+    entry.posting_offset = UINT64_MAX - 1;
+    ok = ok && fseek(f, offset, SEEK_SET) == 0 &&
+         fwrite(&entry, sizeof(entry), 1, f) == 1;
   }
+  return fclose(f) == 0 && ok;
+}
 
-  snprintf(dest, BUFFER_SIZE, "%s %s %s %s", prefix, flags_str, pattern_part,
-           TEST_FILES);
+/**
+ * Создает файлы для проверок с заранее известным результатом:
+ * - fixtures/index: индекс, измененный и новый файлы
+ * - fixtures/broken: индекс с некорректной записью
+ * - fixtures/truncated: обрезанный индекс
+ * - fixtures/brackets.txt: символы между 'Z' и 'a' для -i
+ * - fixtures/concat.gz, truncated.gz, plain.txt: файлы для -z
+ * - fixtures/binary.dat: нулевой байт во второй строке
+ * - fixtures/json.txt: кавычки, '\' и табуляция для --json
+ * @return false при ошибке
+ */
+bool create_fixtures(void) {
+  mkdir(FIXTURE_DIR, 0755);
+  mkdir(FIXTURE_DIR "/index", 0755);
+  return write_fixture(FIXTURE_DIR "/brackets.txt",
+                       "_\n[\n`\n^\nq\nQ\n5\n-\n") &&
+         write_binary_fixture(FIXTURE_DIR "/binary.dat", binary_fixture,
+                              sizeof(binary_fixture) - 1) &&
+         write_fixture(FIXTURE_DIR "/json.txt",
+                       "abxxcx\n\"q\"\\\ttab\nnone\n") &&
+         create_gzip_fixtures() &&
+         write_fixture(FIXTURE_DIR "/index/stale.txt", "old\n") &&
+         create_index_directory(FIXTURE_DIR "/index") &&
+         write_fixture(FIXTURE_DIR "/index/stale.txt", "beta stale\n") &&
+         write_fixture(FIXTURE_DIR "/index/new.txt", "beta new\n") &&
+         create_index_directory(FIXTURE_DIR "/broken") &&
+         break_index(FIXTURE_DIR "/broken") &&
+         create_index_directory(FIXTURE_DIR "/truncated") &&
+         truncate(FIXTURE_DIR "/truncated/" INDEX_FILE_NAME,
+                  sizeof(IndexHeader) + 8) == 0;
+}
+
+/**
+ * Проверяет, принимает ли сервер соединения
+ * @param socket_path Путь к сокету
+ * @return true если соединение установлено
+ */
+bool server_ready(const char *socket_path) {
+  struct sockaddr_un address = {0};
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  bool ready =
+      fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0;
+  if (fd >= 0) close(fd);
+  return ready;
+}
+
+/**
+ * Запускает сервер на SERVE_SOCKET и ждет, пока он начнет принимать
+ * соединения
+ * @return Процесс сервера или -1 при ошибке
+ */
+pid_t start_server(void) {
+  char *argv[] = {"./s21_grep", "--serve", SERVE_SOCKET, NULL};
+  pid_t pid;
+  if (posix_spawn(&pid, argv[0], NULL, NULL, argv, environ) != 0) return -1;
+
+  bool ready = false;
+  for (int i = 0; !ready && i < SERVE_WAIT_STEPS; i++) {
+    ready = server_ready(SERVE_SOCKET);
+    if (!ready && waitpid(pid, NULL, WNOHANG) != 0) return -1;
+    if (!ready) usleep(10000);
+  }
+  if (!ready) {
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return -1;
+  }
+  return pid;
+}
+
+/**
+ * Останавливает сервер
+ * @param pid Процесс сервера (-1 - сервер не запускался)
+ */
+void stop_server(pid_t pid) {
+  if (pid < 0) return;
+  kill(pid, SIGTERM);
+  waitpid(pid, NULL, 0);
 }
 
 /**
- * Тестирует все комбинации флагов для трех режимов:
+ * Добавляет проверки всех комбинаций флагов для трех режимов:
  * 1. Обычный поиск (просто шаблон)
  * 2. Поиск с -f (шаблоны из файла)
  * 3. Поиск с -e (несколько шаблонов)
+ * @param suite Набор проверок
+ * @return false при нехватке памяти
  */
-void test_all_combinations(bool verbose) {
-  int passed = 0, total = 0;
+bool add_all_combinations(TestSuite *suite) {
+  const char *modes[] = {TEST, TEST_F, TEST_E};
+  bool ok = true;
 
   // Тестируем все три режима
-  for (size_t m = 0; m < 3; m++) {
+  for (size_t m = 0; ok && m < 3; m++) {
     // Перебираем все комбинации флагов
-    for (int mask = 1; mask < (1 << MAX_FLAGS); mask++) {
+    for (int mask = 1; ok && mask < (1 << MAX_FLAGS); mask++) {
+      if ((mask & OWX_MASK) == OWX_MASK) continue;
+
       // Формируем строку флагов
-      char flags_str[100] = "";
+      char arguments[BUFFER_SIZE] = "";
       for (int i = 0; i < MAX_FLAGS; i++) {
         if (mask & (1 << i)) {
-          strcat(flags_str, flags[i]);
-          strcat(flags_str, " ");
+          strcat(arguments, flags[i]);
+          strcat(arguments, " ");
         }
       }
+      strcat(arguments, modes[m]);
 
-      char sys_cmd[BUFFER_SIZE], custom_cmd[BUFFER_SIZE];
+      ok = add_test_case(suite, "grep", "./s21_grep", arguments, test_files,
+                         TEST_FILE_COUNT);
+    }
+  }
+  return ok;
+}
 
-      // Формируем команды
-      build_grep_cmd(sys_cmd, "grep", flags_str, m);
-      build_grep_cmd(custom_cmd, "./s21_grep", flags_str, m);
+/**
+ * Добавляет проверки вывода с -Z/--null для всех шаблонов
+ * @param suite Набор проверок
+ * @return false при нехватке памяти
+ */
+bool add_null_cases(TestSuite *suite) {
+  bool ok = true;
+  for (size_t f = 0; ok && f < sizeof(null_flags) / sizeof(null_flags[0]);
+       f++) {
+    for (size_t p = 0; ok && p < sizeof(patterns) / sizeof(patterns[0]);
+         p++) {
+      char arguments[BUFFER_SIZE];
+      snprintf(arguments, sizeof(arguments), "%s %s", null_flags[f],
+               patterns[p]);
+      ok = add_test_case(suite, "grep", "./s21_grep", arguments, test_files,
+                         TEST_FILE_COUNT);
+    }
+  }
+  return ok;
+}
 
-      if (verbose) printf("Testing: %s\n", custom_cmd);
+/**
+ * Добавляет проверки скобочных выражений с -i
+ * @param suite Набор проверок
+ * @return false при нехватке памяти
+ */
+bool add_bracket_cases(TestSuite *suite) {
+  bool ok = true;
+  for (size_t i = 0;
+       ok && i < sizeof(bracket_cases) / sizeof(bracket_cases[0]); i++) {
+    ok = add_test_case(suite, "grep", "./s21_grep", bracket_cases[i],
+                       bracket_file, 1);
+  }
+  return ok;
+}
 
-      // Выполняем и сравниваем
-      char *sys_out = run_cmd(sys_cmd);
-      char *custom_out = run_cmd(custom_cmd);
+/**
+ * Добавляет проверки с заранее известным результатом
+ * @param suite Набор проверок
+ * @return false при нехватке памяти
+ */
+bool add_fixed_cases(TestSuite *suite) {
+  bool ok = true;
+  for (size_t i = 0; ok && i < sizeof(fixed_cases) / sizeof(fixed_cases[0]);
+       i++) {
+    const FixedCase *test = &fixed_cases[i];
+    ok = add_fixed_case(suite, "./s21_grep", test->arguments, NULL, 0,
+                        test->output, test->length, test->errors, test->code);
+  }
+  return ok;
+}
 
-      total++;
-      if (strcmp(sys_out, custom_out) == 0) {
-        passed++;
-      } else {
-        printf("FAIL: %s\n", custom_cmd);
-        printf("Expected:\n%s\nGot:\n%s\n\n", sys_out, custom_out);
-      }
-    }
+/**
+ * Добавляет проверки запросов к серверу
+ * @param suite Набор проверок
+ * @return false при нехватке памяти
+ */
+bool add_serve_cases(TestSuite *suite) {
+  bool ok = true;
+  for (size_t i = 0; ok && i < sizeof(serve_cases) / sizeof(serve_cases[0]);
+       i++) {
+    const FixedCase *test = &serve_cases[i];
+    ok = add_fixed_case(suite, "env", test->arguments, NULL, 0, test->output,
+                        test->length, test->errors, test->code);
   }
+  return ok;
+}
+
+/**
+ * Добавляет проверки на сгенерированных наборах (--large)
+ * @param suite Набор проверок
+ * @param corpora Сгенерированные наборы
+ * @return false при нехватке памяти
+ */
+bool add_large_cases(TestSuite *suite, const BenchCorpus *corpora) {
+  bool ok = true;
+  for (size_t i = 0; ok && i < sizeof(large_cases) / sizeof(large_cases[0]);
+       i++) {
+    const BenchCase *test = &large_cases[i];
+    const BenchCorpus *corpus = &corpora[test->corpus];
+    char arguments[BUFFER_SIZE];
+    snprintf(arguments, sizeof(arguments), "%s%s%s", test->flags,
+             test->flags[0] ? " " : "", test->pattern);
 
-  printf("\nResults: %d/%d passed (%.1f%%)\n", passed, total,
-         (float)passed / total * 100);
+    ok = add_test_case(suite, "grep", "./s21_grep", arguments, corpus->paths,
+                       corpus->count);
+  }
+  return ok;
 }
 
+/**
+ * Точка входа
+ * @param argc Количество аргументов командной строки
+ * @param argv [+] [-j потоки] [--large МБ]
+ * @return 0 если все проверки пройдены
+ */
 int main(int argc, char **argv) {
+  TestSuite suite;
+  if (!init_test_suite(&suite, argc, argv)) return EXIT_FAILURE;
   create_test_files();
-  test_all_combinations(argc > 1 && strcmp(argv[1], "+") == 0);
-  return 0;
-}
\ No newline at end of file
+
+  BenchCorpus corpora[CORPUS_COUNT] = {0};
+  bool ok = create_fixtures() && add_all_combinations(&suite) &&
+            add_null_cases(&suite) && add_bracket_cases(&suite) &&
+            add_fixed_cases(&suite) && add_serve_cases(&suite);
+  if (ok && suite.large_mb > 0) {
+    ok = generate_corpora(suite.large_mb, corpora) &&
+         add_large_cases(&suite, corpora);
+  }
+  pid_t server = ok ? start_server() : -1;
+  ok = ok && server > 0;
+
+  size_t failed = ok ? run_test_suite(&suite) : 1;
+  stop_server(server);
+  if (!ok) fprintf(stderr, "Ошибка: Не удалось подготовить проверки\n");
+  free_test_suite(&suite);
+  free_corpora(corpora);
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}